@@ -0,0 +1,117 @@
+#include "AllocationCounter.h"
+#include <opencv2/core.hpp>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+std::atomic<int> activeCounters{0};
+std::atomic<size_t> allocations{0};
+std::atomic<size_t> excludedAllocations{0};
+thread_local int excludedDepth = 0;
+
+void noteAllocation() {
+    if (activeCounters.load(std::memory_order_relaxed) > 0) {
+        (excludedDepth > 0 ? excludedAllocations : allocations).fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+// Pixel buffers come from cv::fastMalloc, which operator new never sees
+class CountingMatAllocator : public cv::MatAllocator {
+public:
+    cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step,
+                           cv::AccessFlag flags, cv::UMatUsageFlags usageFlags) const override {
+        if (!data) noteAllocation();            // Headers over user memory allocate nothing
+        return cv::Mat::getStdAllocator()->allocate(dims, sizes, type, data, step, flags, usageFlags);
+    }
+
+    bool allocate(cv::UMatData* data, cv::AccessFlag flags, cv::UMatUsageFlags usageFlags) const override {
+        return cv::Mat::getStdAllocator()->allocate(data, flags, usageFlags);
+    }
+
+    void deallocate(cv::UMatData* data) const override {
+        cv::Mat::getStdAllocator()->deallocate(data);
+    }
+};
+
+void installMatAllocator() {
+    static CountingMatAllocator allocator;
+    static bool installed = (cv::Mat::setDefaultAllocator(&allocator), true);
+    (void)installed;
+}
+
+} // namespace
+
+AllocationCounter::AllocationCounter() {
+    installMatAllocator();
+    activeCounters++;
+    m_start = allocations.load();
+    m_excludedStart = excludedAllocations.load();
+}
+
+AllocationCounter::~AllocationCounter() {
+    activeCounters--;
+}
+
+size_t AllocationCounter::count() const {
+    return allocations.load() - m_start;
+}
+
+size_t AllocationCounter::excludedCount() const {
+    return excludedAllocations.load() - m_excludedStart;
+}
+
+void AllocationCounter::setThreadExcluded(bool excluded) {
+    excludedDepth += excluded ? 1 : -1;
+}
+
+void* operator new(std::size_t size) {
+    noteAllocation();
+    for (;;) {
+        if (void* memory = std::malloc(size > 0 ? size : 1)) return memory;
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) throw std::bad_alloc();
+        handler();
+    }
+}
+
+void* operator new[](std::size_t size) {
+    return ::operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return ::operator new(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return ::operator new(size, std::nothrow);
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept {
+    std::free(memory);
+}
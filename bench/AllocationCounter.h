@@ -0,0 +1,29 @@
+#ifndef ALLOCATIONCOUNTER_H
+#define ALLOCATIONCOUNTER_H
+
+#include <cstddef>
+
+// Counts operator new calls and cv::Mat buffer allocations from every thread
+// while at least one counter is alive. The bench binary replaces the global
+// operator new and installs a counting cv::MatAllocator for this; with no
+// counter alive it costs one relaxed load per allocation.
+class AllocationCounter {
+public:
+    AllocationCounter();
+    ~AllocationCounter();
+    AllocationCounter(const AllocationCounter&) = delete;
+    AllocationCounter& operator=(const AllocationCounter&) = delete;
+
+    size_t count() const;                           // Allocations since construction, excluded ones aside
+    size_t excludedCount() const;                   // Allocations inside excluded scopes since construction
+
+    // Allocations on the calling thread go to excludedCount() until the scope
+    // ends - for work that isn't the code under test, such as ONNX Runtime's Run
+    static void setThreadExcluded(bool excluded);
+
+private:
+    size_t m_start;
+    size_t m_excludedStart;
+};
+
+#endif // ALLOCATIONCOUNTER_H
@@ -0,0 +1,128 @@
+#include "BenchHarness.h"
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRegularExpression>
+#include <QSysInfo>
+#include <QThread>
+#include <QTextStream>
+#include <algorithm>
+#include <ctime>
+#include <vector>
+
+void BenchHarness::add(Case benchCase) {
+    if (!m_filter.isEmpty() && !benchCase.name.contains(QRegularExpression(m_filter))) return;
+    m_cases.append(std::move(benchCase));
+}
+
+BenchHarness::Result BenchHarness::measure(const Case& benchCase) const {
+    // One untimed warm-up so lazy allocations and model loads don't skew the first sample
+    if (benchCase.setup) benchCase.setup();
+    benchCase.run();
+
+    std::vector<double> samples;
+    double cpuTotal = 0.0;
+    double wallTotal = 0.0;
+    QElapsedTimer timer;
+
+    while (samples.size() < static_cast<size_t>(MAX_ITERATIONS) &&
+           (samples.empty() || wallTotal < m_minTime)) {
+        if (benchCase.setup) benchCase.setup();
+
+        std::clock_t cpuStart = std::clock();
+        timer.start();
+        benchCase.run();
+        double wall = timer.nsecsElapsed() / 1e9;
+        cpuTotal += static_cast<double>(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+
+        samples.push_back(wall);
+        wallTotal += wall;
+    }
+
+    Result result;
+    result.name = benchCase.name;
+    result.iterations = static_cast<int>(samples.size());
+    result.realMs = wallTotal / samples.size() * 1000.0;
+    result.cpuMs = cpuTotal / samples.size() * 1000.0;
+    std::sort(samples.begin(), samples.end());
+    result.medianMs = samples[samples.size() / 2] * 1000.0;
+    result.minMs = samples.front() * 1000.0;
+    if (benchCase.megapixels > 0.0 && wallTotal > 0.0) {
+        result.megapixelsPerSecond = benchCase.megapixels * samples.size() / wallTotal;
+    }
+    if (benchCase.label) {
+        result.label = benchCase.label();
+    }
+    return result;
+}
+
+void BenchHarness::run() {
+    QTextStream out(stdout);
+    out << QString("%1 %2 %3 %4 %5\n")
+               .arg("benchmark", -48).arg("time ms", 12).arg("cpu ms", 12)
+               .arg("iters", 8).arg("MP/s", 10);
+    out << QString(94, '-') << "\n";
+    out.flush();
+
+    m_results.clear();
+    for (const Case& benchCase : m_cases) {
+        Result result = measure(benchCase);
+        m_results.append(result);
+        out << QString("%1 %2 %3 %4 %5\n")
+                   .arg(result.name, -48)
+                   .arg(result.realMs, 12, 'f', 3)
+                   .arg(result.cpuMs, 12, 'f', 3)
+                   .arg(result.iterations, 8)
+                   .arg(result.megapixelsPerSecond, 10, 'f', 1);
+        if (!result.label.isEmpty()) {
+            out << QString(48, ' ') << "  " << result.label << "\n";
+        }
+        out.flush();
+    }
+}
+
+bool BenchHarness::writeJson(const QString& path) const {
+    QJsonObject context;
+    context["date"] = QDateTime::currentDateTime().toString(Qt::ISODate);
+    context["host_name"] = QSysInfo::machineHostName();
+    context["num_cpus"] = QThread::idealThreadCount();
+    context["cpu_architecture"] = QSysInfo::currentCpuArchitecture();
+#ifdef NDEBUG
+    context["library_build_type"] = "release";
+#else
+    context["library_build_type"] = "debug";
+#endif
+
+    QJsonArray benchmarks;
+    for (const Result& result : m_results) {
+        QJsonObject entry;
+        entry["name"] = result.name;
+        entry["run_name"] = result.name;
+        entry["run_type"] = "iteration";
+        entry["iterations"] = result.iterations;
+        entry["real_time"] = result.realMs;
+        entry["cpu_time"] = result.cpuMs;
+        entry["time_unit"] = "ms";
+        entry["median_time"] = result.medianMs;
+        entry["min_time"] = result.minMs;
+        if (result.megapixelsPerSecond > 0.0) {
+            entry["megapixels_per_second"] = result.megapixelsPerSecond;
+        }
+        if (!result.label.isEmpty()) {
+            entry["label"] = result.label;
+        }
+        benchmarks.append(entry);
+    }
+
+    QJsonObject root;
+    root["context"] = context;
+    root["benchmarks"] = benchmarks;
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+    file.write(QJsonDocument(root).toJson());
+    return true;
+}
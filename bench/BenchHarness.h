@@ -0,0 +1,53 @@
+#ifndef BENCHHARNESS_H
+#define BENCHHARNESS_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <functional>
+
+// Minimal Google Benchmark style runner. Each case repeats until a minimum time
+// is spent, with an untimed setup before every iteration. JSON output follows
+// the Google Benchmark schema so its compare.py can diff two builds.
+class BenchHarness {
+public:
+    struct Case {
+        QString name;
+        std::function<void()> setup;                // Untimed, before every iteration (optional)
+        std::function<void()> run;
+        double megapixels = 0.0;                    // Reported as a throughput counter when > 0
+        std::function<QString()> label;             // Read after the last iteration (optional)
+    };
+
+    struct Result {
+        QString name;
+        int iterations = 0;
+        double realMs = 0.0;                        // Mean wall time per iteration
+        double cpuMs = 0.0;                         // Mean process CPU time per iteration
+        double medianMs = 0.0;
+        double minMs = 0.0;
+        double megapixelsPerSecond = 0.0;
+        QString label;
+    };
+
+    void setFilter(const QString& pattern) { m_filter = pattern; }
+    void setMinTime(double seconds) { m_minTime = seconds; }
+
+    void add(Case benchCase);
+    void run();
+
+    const QVector<Result>& results() const { return m_results; }
+    bool writeJson(const QString& path) const;
+
+private:
+    Result measure(const Case& benchCase) const;
+
+    QVector<Case> m_cases;
+    QVector<Result> m_results;
+    QString m_filter;
+    double m_minTime = 0.5;
+
+    static constexpr int MAX_ITERATIONS = 1000;
+};
+
+#endif // BENCHHARNESS_H
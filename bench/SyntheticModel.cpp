@@ -0,0 +1,103 @@
+#include "SyntheticModel.h"
+#include <cstdint>
+
+namespace {
+
+// Just enough protobuf wire format for the handful of ONNX messages used below
+enum WireType { Varint = 0, LengthDelimited = 2 };
+
+void writeVarint(QByteArray& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.append(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.append(static_cast<char>(value));
+}
+
+void writeTag(QByteArray& out, int field, WireType type) {
+    writeVarint(out, (static_cast<uint64_t>(field) << 3) | type);
+}
+
+void writeInt(QByteArray& out, int field, int64_t value) {
+    writeTag(out, field, Varint);
+    writeVarint(out, static_cast<uint64_t>(value));
+}
+
+void writeBytes(QByteArray& out, int field, const QByteArray& bytes) {
+    writeTag(out, field, LengthDelimited);
+    writeVarint(out, static_cast<uint64_t>(bytes.size()));
+    out.append(bytes);
+}
+
+// TensorShapeProto.Dimension: dim_value = 1, dim_param = 2
+QByteArray dimension(const char* param, int64_t value = 0) {
+    QByteArray dim;
+    if (param) {
+        writeBytes(dim, 2, param);
+    } else {
+        writeInt(dim, 1, value);
+    }
+    return dim;
+}
+
+// ValueInfoProto for a float NCHW tensor with symbolic batch and spatial dims
+QByteArray floatImageInfo(const char* name, const char* height, const char* width) {
+    QByteArray shape;                               // TensorShapeProto: dim = 1
+    writeBytes(shape, 1, dimension("N"));
+    writeBytes(shape, 1, dimension(nullptr, 3));
+    writeBytes(shape, 1, dimension(height));
+    writeBytes(shape, 1, dimension(width));
+
+    QByteArray tensorType;                          // TypeProto.Tensor: elem_type = 1, shape = 2
+    writeInt(tensorType, 1, 1);                     // FLOAT
+    writeBytes(tensorType, 2, shape);
+
+    QByteArray type;                                // TypeProto: tensor_type = 1
+    writeBytes(type, 1, tensorType);
+
+    QByteArray info;                                // ValueInfoProto: name = 1, type = 2
+    writeBytes(info, 1, name);
+    writeBytes(info, 2, type);
+    return info;
+}
+
+} // namespace
+
+QByteArray syntheticUpscaleModel(int scale) {
+    // TensorProto: dims = 1, data_type = 2, name = 8, raw_data = 9
+    const float scales[4] = {1.0f, 1.0f, static_cast<float>(scale), static_cast<float>(scale)};
+    QByteArray scalesTensor;
+    writeInt(scalesTensor, 1, 4);
+    writeInt(scalesTensor, 2, 1);                   // FLOAT
+    writeBytes(scalesTensor, 8, "scales");
+    writeBytes(scalesTensor, 9, QByteArray(reinterpret_cast<const char*>(scales), sizeof(scales)));
+
+    // NodeProto: input = 1, output = 2, name = 3, op_type = 4. Empty input skips roi.
+    QByteArray node;
+    writeBytes(node, 1, "input");
+    writeBytes(node, 1, "");
+    writeBytes(node, 1, "scales");
+    writeBytes(node, 2, "output");
+    writeBytes(node, 3, "upsample");
+    writeBytes(node, 4, "Resize");
+
+    // GraphProto: node = 1, name = 2, initializer = 5, input = 11, output = 12
+    QByteArray graph;
+    writeBytes(graph, 1, node);
+    writeBytes(graph, 2, "synthetic_upscaler");
+    writeBytes(graph, 5, scalesTensor);
+    writeBytes(graph, 11, floatImageInfo("input", "H", "W"));
+    writeBytes(graph, 12, floatImageInfo("output", "H_out", "W_out"));
+
+    // OperatorSetIdProto: version = 2 (default domain)
+    QByteArray opset;
+    writeInt(opset, 2, 13);
+
+    // ModelProto: ir_version = 1, producer_name = 2, graph = 7, opset_import = 8
+    QByteArray model;
+    writeInt(model, 1, 7);
+    writeBytes(model, 2, "pixeleraser_bench");
+    writeBytes(model, 7, graph);
+    writeBytes(model, 8, opset);
+    return model;
+}
@@ -0,0 +1,11 @@
+#ifndef SYNTHETICMODEL_H
+#define SYNTHETICMODEL_H
+
+#include <QByteArray>
+
+// Serialised ONNX model with the Real-ESRGAN interface - float32 [N,3,H,W] in,
+// [N,3,H*scale,W*scale] out - built from a single nearest Resize node.
+// Lets the upscale pipeline (tiling, batching, blending) be timed without the real weights.
+QByteArray syntheticUpscaleModel(int scale);
+
+#endif // SYNTHETICMODEL_H
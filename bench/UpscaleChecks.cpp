@@ -0,0 +1,215 @@
+#include "UpscaleChecks.h"
+#include <QTextStream>
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <vector>
+#include "AllocationCounter.h"
+#include "UpscaleSink.h"
+#include "Upscaler.h"
+
+namespace {
+
+constexpr int SCALE = 2;                        // The synthetic model is installed as the x2 model
+constexpr int CHECK_TILE = 128;
+constexpr int CHECK_OVERLAP = 16;
+constexpr int ALLOCATION_BANDS = 8;
+constexpr int ALLOCATION_TILES_ACROSS = 4;
+constexpr int SEAM_TILES_ACROSS = 4;
+constexpr int SEAM_TILES_DOWN = 3;
+constexpr double MAX_SEAM_ERROR = 0.5;          // Mean 8-bit levels along the worst line near a boundary
+constexpr double MAX_ALPHA_BAND_ERROR = 1.0;    // Largest alpha difference, in 8-bit levels
+
+// Notes the allocation count whenever a band is committed
+class CountingSink : public MatUpscaleSink {
+public:
+    CountingSink(const AllocationCounter& counter, int bands) : m_counter(counter) {
+        m_marks.reserve(bands);
+    }
+
+    bool commitBand(int y, int rows) override {
+        m_marks.push_back(m_counter.count());
+        return MatUpscaleSink::commitBand(y, rows);
+    }
+
+    const std::vector<size_t>& marks() const { return m_marks; }
+
+private:
+    const AllocationCounter& m_counter;
+    std::vector<size_t> m_marks;
+};
+
+// Once a run's buffers, bindings and workers exist, no band may allocate outside
+// ONNX Runtime's Run calls. Those are excluded on the thread that makes them, so
+// the sessions get one intra-op thread each and Run never leaves that thread.
+bool checkBandAllocations() {
+    const int cores = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    Upscaler upscaler;
+    upscaler.setPrecision(Upscaler::PrecisionFP32);
+    upscaler.setTileSize(CHECK_TILE);
+    upscaler.setTileOverlap(CHECK_OVERLAP);
+    upscaler.setMaxBatchSize(1);                // Batches would merge the bands
+    upscaler.setMaxConcurrentTiles(cores);
+    upscaler.setRunObserver(&AllocationCounter::setThreadExcluded);
+
+    // Opaque RGB, at least a tile per worker across - one tile row per band,
+    // and no alpha post-processing
+    const int tilesAcross = std::max(ALLOCATION_TILES_ACROSS, cores);
+    cv::Mat image(CHECK_TILE * ALLOCATION_BANDS, CHECK_TILE * tilesAcross, CV_8UC3);
+    cv::randu(image, cv::Scalar::all(0), cv::Scalar::all(255));
+    MatUpscaleSink warmup;
+    if (!upscaler.upscaleToSink(image, Upscaler::RealESRGAN_x2, SCALE, warmup)) {
+        QTextStream(stdout) << "FAIL band-allocations: upscale failed\n";
+        return false;
+    }
+    if (upscaler.lastStats().intraOpThreads != 1) {
+        QTextStream(stdout) << "FAIL band-allocations: " << upscaler.lastStats().intraOpThreads
+                            << " intra-op threads - Run allocations would escape the exclusion\n";
+        return false;
+    }
+
+    AllocationCounter counter;
+    CountingSink sink(counter, ALLOCATION_BANDS);
+    if (!upscaler.upscaleToSink(image, Upscaler::RealESRGAN_x2, SCALE, sink)) {
+        QTextStream(stdout) << "FAIL band-allocations: upscale failed\n";
+        return false;
+    }
+    const size_t runAllocations = counter.excludedCount();
+    const std::vector<size_t>& marks = sink.marks();
+    if (marks.size() < 3) {
+        QTextStream(stdout) << "FAIL band-allocations: only " << marks.size() << " band(s)\n";
+        return false;
+    }
+
+    // The first band includes setting the run up; every later one is steady state
+    size_t worst = 0;
+    int allocatingBands = 0;
+    for (size_t band = 1; band < marks.size(); ++band) {
+        size_t allocations = marks[band] - marks[band - 1];
+        worst = std::max(worst, allocations);
+        if (allocations > 0) allocatingBands++;
+    }
+    bool pass = allocatingBands == 0;
+    QTextStream(stdout) << (pass ? "PASS" : "FAIL") << " band-allocations: " << allocatingBands << " of "
+                        << marks.size() - 1 << " steady-state bands allocate, worst " << worst << " ("
+                        << runAllocations << " inside ONNX Runtime Run calls, not counted)\n";
+    return pass;
+}
+
+// Worst mean difference along any output row or column within the feathered
+// overlap of a tile boundary
+double seamError(const cv::Mat& tiled, const cv::Mat& reference, int scale) {
+    cv::Mat diff;
+    cv::absdiff(tiled, reference, diff);
+    diff = diff.reshape(1, diff.rows);          // Channels side by side
+    const int channels = tiled.channels();
+    const int band = CHECK_OVERLAP * scale;
+
+    double worst = 0.0;
+    for (int boundary = CHECK_TILE * scale; boundary < tiled.cols; boundary += CHECK_TILE * scale) {
+        for (int x = boundary - band; x < boundary + band; ++x) {
+            worst = std::max(worst, cv::mean(diff.colRange(x * channels, (x + 1) * channels))[0]);
+        }
+    }
+    for (int boundary = CHECK_TILE * scale; boundary < tiled.rows; boundary += CHECK_TILE * scale) {
+        for (int y = boundary - band; y < boundary + band; ++y) {
+            worst = std::max(worst, cv::mean(diff.row(y))[0]);
+        }
+    }
+    return worst;
+}
+
+// A smooth gradient split into feathered tiles must match the same image run as
+// one tile - the synthetic model is shift invariant, so any seam is the blend's
+bool checkTileSeams() {
+    const int width = CHECK_TILE * SEAM_TILES_ACROSS;
+    const int height = CHECK_TILE * SEAM_TILES_DOWN;
+    cv::Mat gradient(height, width, CV_8UC3);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            gradient.at<cv::Vec3b>(y, x) = cv::Vec3b(cv::saturate_cast<uchar>(255.0 * x / width),
+                                                     cv::saturate_cast<uchar>(255.0 * y / height),
+                                                     cv::saturate_cast<uchar>(128 + 64.0 * (x - y) / width));
+        }
+    }
+
+    Upscaler upscaler;
+    upscaler.setPrecision(Upscaler::PrecisionFP32);
+    upscaler.setTileOverlap(CHECK_OVERLAP);
+
+    upscaler.setTileSize(std::max(width, height));
+    MatUpscaleSink single;
+    bool ran = upscaler.upscaleToSink(gradient, Upscaler::RealESRGAN_x2, SCALE, single);
+
+    upscaler.setTileSize(CHECK_TILE);
+    MatUpscaleSink tiled;
+    ran = ran && upscaler.upscaleToSink(gradient, Upscaler::RealESRGAN_x2, SCALE, tiled);
+    if (!ran) {
+        QTextStream(stdout) << "FAIL tile-seams: upscale failed\n";
+        return false;
+    }
+
+    double error = seamError(tiled.result(), single.result(), SCALE);
+    bool pass = error <= MAX_SEAM_ERROR;
+    QTextStream(stdout) << (pass ? "PASS" : "FAIL") << " tile-seams: " << error
+                        << " mean levels off the single-tile result at a tile boundary (limit "
+                        << MAX_SEAM_ERROR << ")\n";
+    return pass;
+}
+
+// Guided alpha filtered band by band must match the same cut-out done as one
+// band - each band needs real colour context either side of the rows it writes
+bool checkGuidedAlphaBands() {
+    const int width = CHECK_TILE * 2;
+    const int height = CHECK_TILE * SEAM_TILES_DOWN;
+    cv::Mat cutout(height, width, CV_8UC4);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            // Diagonal stripes give the guide edges; alpha falls off radially but
+            // never reaches zero, so no tile is skipped as transparent
+            uchar shade = ((x + y) / 6) % 2 ? 200 : 60;
+            double distance = std::hypot(x - width / 2.0, y - height / 2.0) / std::hypot(width, height);
+            cutout.at<cv::Vec4b>(y, x) = cv::Vec4b(shade, 255 - shade, 128,
+                                                   cv::saturate_cast<uchar>(255.0 - 400.0 * distance));
+        }
+    }
+
+    Upscaler upscaler;
+    upscaler.setPrecision(Upscaler::PrecisionFP32);
+    upscaler.setTileOverlap(CHECK_OVERLAP);
+    upscaler.setAlphaMode(Upscaler::AlphaGuided);
+    upscaler.setMaxConcurrentTiles(1);          // One tile row per band
+    upscaler.setMaxBatchSize(1);
+
+    upscaler.setTileSize(std::max(width, height));
+    MatUpscaleSink single;
+    bool ran = upscaler.upscaleToSink(cutout, Upscaler::RealESRGAN_x2, SCALE, single);
+
+    upscaler.setTileSize(CHECK_TILE);
+    MatUpscaleSink banded;
+    ran = ran && upscaler.upscaleToSink(cutout, Upscaler::RealESRGAN_x2, SCALE, banded);
+    if (!ran) {
+        QTextStream(stdout) << "FAIL guided-alpha-bands: upscale failed\n";
+        return false;
+    }
+
+    cv::Mat singleAlpha, bandedAlpha, diff;
+    cv::extractChannel(single.result(), singleAlpha, 3);
+    cv::extractChannel(banded.result(), bandedAlpha, 3);
+    cv::absdiff(singleAlpha, bandedAlpha, diff);
+    double error = 0.0;
+    cv::minMaxLoc(diff, nullptr, &error);
+    bool pass = error <= MAX_ALPHA_BAND_ERROR;
+    QTextStream(stdout) << (pass ? "PASS" : "FAIL") << " guided-alpha-bands: alpha up to " << error
+                        << " levels off the single-band result (limit " << MAX_ALPHA_BAND_ERROR << ")\n";
+    return pass;
+}
+
+} // namespace
+
+bool runUpscaleChecks() {
+    bool pass = checkBandAllocations();
+    pass = checkTileSeams() && pass;
+    pass = checkGuidedAlphaBands() && pass;
+    return pass;
+}
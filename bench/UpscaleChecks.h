@@ -0,0 +1,8 @@
+#ifndef UPSCALECHECKS_H
+#define UPSCALECHECKS_H
+
+// Pass/fail regression checks of the upscale pipeline on the synthetic model,
+// which must already be installed. Prints one line per check; false if any failed.
+bool runUpscaleChecks();
+
+#endif // UPSCALECHECKS_H
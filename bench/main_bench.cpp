@@ -0,0 +1,345 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QFile>
+#include <QImage>
+#include <QPainter>
+#include <QStandardPaths>
+#include <QTextStream>
+#include <cmath>
+#include <memory>
+#include "BenchHarness.h"
+#include "ImageProcessor.h"
+#include "PngWriter.h"
+#include "SyntheticModel.h"
+#include "UpscaleChecks.h"
+#include "UpscaleSink.h"
+#include "Upscaler.h"
+
+namespace {
+
+constexpr int STROKE_LENGTH = 1024;
+constexpr int STROKE_STEP = 16;
+constexpr double MAX_UPSCALE_MEGAPIXELS = 10.0;   // 2x of 100 MP would need several GB of output
+constexpr double MAX_ENCODE_MEGAPIXELS = 50.0;    // Single-threaded cv::imwrite takes minutes beyond this
+
+enum Background { Uniform, Noisy, Gradient };
+
+QString backgroundName(Background background) {
+    switch (background) {
+        case Uniform: return "uniform";
+        case Noisy: return "noisy";
+        case Gradient: return "gradient";
+    }
+    return "";
+}
+
+// 4:3 BGRA product shot - a background auto-color can remove around an opaque subject
+cv::Mat syntheticImage(double megapixels, Background background) {
+    int width = cvRound(std::sqrt(megapixels * 1e6 * 4.0 / 3.0));
+    int height = cvRound(width * 3.0 / 4.0);
+
+    cv::Mat bgr(height, width, CV_8UC3, cv::Scalar(235, 235, 235));
+    if (background == Gradient) {
+        cv::Mat row(1, width, CV_8UC3);
+        for (int x = 0; x < width; ++x) {
+            uchar value = cv::saturate_cast<uchar>(200 + 50.0 * x / width);
+            row.at<cv::Vec3b>(0, x) = cv::Vec3b(value, value, value);
+        }
+        cv::repeat(row, height, 1, bgr);
+    }
+
+    cv::circle(bgr, cv::Point(width / 2, height / 2), std::min(width, height) / 3,
+               cv::Scalar(40, 90, 180), cv::FILLED);
+
+    if (background == Noisy) {
+        cv::Mat noise(bgr.size(), CV_16SC3);
+        cv::theRNG().state = 42;
+        cv::randn(noise, 0, 6);
+        cv::Mat noisy;
+        bgr.convertTo(noisy, CV_16SC3);
+        noisy += noise;
+        noisy.convertTo(bgr, CV_8UC3);
+    }
+
+    cv::Mat bgra;
+    cv::cvtColor(bgr, bgra, cv::COLOR_BGR2BGRA);
+    return bgra;
+}
+
+// Mouse-move sized segments along a horizontal stroke through the centre
+std::vector<std::pair<QPoint, QPoint>> strokeSegments(const cv::Mat& image) {
+    std::vector<std::pair<QPoint, QPoint>> segments;
+    int y = image.rows / 2;
+    int length = std::min(image.cols - 1, STROKE_LENGTH);
+    int x0 = (image.cols - length) / 2;
+    for (int x = x0; x + STROKE_STEP <= x0 + length; x += STROKE_STEP) {
+        segments.emplace_back(QPoint(x, y), QPoint(x + STROKE_STEP, y + (x / STROKE_STEP % 2)));
+    }
+    return segments;
+}
+
+// Shared processor that reloads only when a case needs a different source image
+struct Fixture {
+    ImageProcessor processor;
+    const cv::Mat* loaded = nullptr;
+
+    void load(const cv::Mat& image) {
+        processor.replaceImage(image);  // Shared copy-on-write - edits never reach the source
+        processor.resetChangeTracking();
+        loaded = &image;
+    }
+
+    void ensureLoaded(const cv::Mat& image) {
+        if (loaded != &image || processor.getCurrentImage().size() != image.size()) {
+            load(image);
+        }
+    }
+};
+
+// Real-ESRGAN file names under Qt's test-mode app data, so the user's models are untouched
+bool installSyntheticModel() {
+    QDir dir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/models");
+    if (!dir.mkpath(".")) return false;
+    QFile file(dir.filePath("real_esrgan_x2.onnx"));
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+    return file.write(syntheticUpscaleModel(2)) > 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("pixeleraser_bench");
+    app.setOrganizationName("PixelEraser");
+    QStandardPaths::setTestModeEnabled(true);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Image engine microbenchmarks");
+    parser.addHelpOption();
+    QCommandLineOption filterOption("benchmark_filter", "Regex of benchmarks to run.", "regex");
+    QCommandLineOption outOption("benchmark_out", "Write JSON results to this file.", "file");
+    QCommandLineOption minTimeOption("benchmark_min_time", "Minimum seconds per benchmark.", "seconds", "0.5");
+    QCommandLineOption sizesOption("sizes", "Comma separated image sizes in megapixels.", "list", "1,10,100");
+    QCommandLineOption checksOption("checks", "Run the upscale regression checks instead of benchmarks.");
+    parser.addOption(filterOption);
+    parser.addOption(outOption);
+    parser.addOption(minTimeOption);
+    parser.addOption(sizesOption);
+    parser.addOption(checksOption);
+    parser.process(app);
+
+    BenchHarness harness;
+    harness.setFilter(parser.value(filterOption));
+    harness.setMinTime(parser.value(minTimeOption).toDouble());
+
+    auto fixture = std::make_shared<Fixture>();
+    ImageProcessor* processor = &fixture->processor;
+    auto upscaler = std::make_shared<Upscaler>();
+    upscaler->setPrecision(Upscaler::PrecisionFP32);
+    bool haveModel = installSyntheticModel();
+    if (!haveModel) {
+        QTextStream(stderr) << "Could not write the synthetic model - skipping upscale benchmarks\n";
+    }
+    if (parser.isSet(checksOption)) {
+        return haveModel && runUpscaleChecks() ? 0 : 1;
+    }
+    const QString mappedPath = QDir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation))
+                                   .filePath("upscale_output.raw");
+
+    for (const QString& sizeText : parser.value(sizesOption).split(',', Qt::SkipEmptyParts)) {
+        double megapixels = sizeText.toDouble();
+        if (megapixels <= 0.0) continue;
+        QString suffix = QString("/%1MP").arg(sizeText.trimmed());
+
+        auto uniform = std::make_shared<cv::Mat>(syntheticImage(megapixels, Uniform));
+        double actualMegapixels = uniform->total() / 1e6;
+
+        for (Background background : {Uniform, Noisy, Gradient}) {
+            auto image = background == Uniform ? uniform
+                                               : std::make_shared<cv::Mat>(syntheticImage(megapixels, background));
+            harness.add({"autoColorRemove/" + backgroundName(background) + suffix,
+                         [fixture, processor, image]() {
+                             // Restore alpha as one patch, so the LAB cache stays warm
+                             fixture->ensureLoaded(*image);
+                             processor->restoreTiles({{cv::Rect(0, 0, image->cols, image->rows), *image}});
+                             processor->resetChangeTracking();
+                         },
+                         [processor]() { processor->autoColorRemove(0, 0, 30, QRect()); },
+                         actualMegapixels});
+        }
+
+        for (int brush : {10, 50, 200}) {
+            QString name = QString("/brush:%1").arg(brush) + suffix;
+            harness.add({"eraseAlongPath" + name,
+                         [fixture, processor, uniform]() {
+                             fixture->ensureLoaded(*uniform);
+                             processor->resetChangeTracking();
+                         },
+                         [processor, brush]() {
+                             for (const auto& segment : strokeSegments(processor->getCurrentImage())) {
+                                 processor->eraseAlongPath(segment.first, segment.second, brush);
+                             }
+                         }});
+            harness.add({"repairAlongPath" + name,
+                         [fixture, processor, uniform]() {
+                             fixture->ensureLoaded(*uniform);
+                             processor->resetChangeTracking();
+                         },
+                         [processor, brush]() {
+                             for (const auto& segment : strokeSegments(processor->getCurrentImage())) {
+                                 processor->repairAlongPath(segment.first, segment.second, brush);
+                             }
+                         }});
+        }
+
+        // A 1080p viewport worth of the display image
+        auto display = std::make_shared<QImage>(uniform->cols, uniform->rows, QImage::Format_ARGB32_Premultiplied);
+        harness.add({"updateDisplayRegion" + suffix,
+                     [fixture, uniform]() {
+                         fixture->ensureLoaded(*uniform);
+                     },
+                     [processor, display]() {
+                         processor->updateDisplayRegion(*display, QRect(0, 0, 1920, 1080));
+                     },
+                     std::min(actualMegapixels, 1920.0 * 1080.0 / 1e6)});
+
+        // One canvas frame into a 1080p backing store - the whole image at fit zoom (smooth),
+        // or 1:1 while panning. A straight-alpha cache is converted by QPainter on every draw.
+        auto frame = std::make_shared<QImage>(1920, 1080, QImage::Format_ARGB32_Premultiplied);
+        QImage premultiplied = ImageProcessor::toDisplayImage(*uniform);
+        std::vector<std::pair<QString, std::shared_ptr<QImage>>> caches = {
+            {"rgba8888", std::make_shared<QImage>(premultiplied.convertToFormat(QImage::Format_RGBA8888))},
+            {"premultiplied", std::make_shared<QImage>(premultiplied)}};
+        for (const auto& cache : caches) {
+            std::shared_ptr<QImage> source = cache.second;
+            harness.add({"drawImage/fit/" + cache.first + suffix,
+                         nullptr,
+                         [frame, source]() {
+                             QPainter painter(frame.get());
+                             painter.setRenderHint(QPainter::SmoothPixmapTransform, true);
+                             QSizeF fitted = QSizeF(source->size()).scaled(frame->size(), Qt::KeepAspectRatio);
+                             painter.drawImage(QRectF(QPointF(0, 0), fitted), *source);
+                         },
+                         1920.0 * 1080.0 / 1e6});
+            harness.add({"drawImage/pan/" + cache.first + suffix,
+                         nullptr,
+                         [frame, source]() {
+                             QPainter painter(frame.get());
+                             painter.drawImage(QRectF(-100, -100, source->width(), source->height()), *source);
+                         },
+                         std::min(actualMegapixels, 1920.0 * 1080.0 / 1e6)});
+        }
+
+        for (int level = 1; level <= 5; ++level) {
+            harness.add({QString("applySoftening/level:%1").arg(level) + suffix,
+                         nullptr,
+                         [processor, uniform, level]() { processor->applySoftening(*uniform, level); },
+                         actualMegapixels});
+        }
+
+        auto state = std::make_shared<cv::Mat>();
+        harness.add({"captureState" + suffix,
+                     [fixture, uniform]() {
+                         fixture->ensureLoaded(*uniform);
+                     },
+                     [processor, state]() { *state = processor->captureState(); },
+                     actualMegapixels});
+        // A snapshot of an edited state - restoring the unedited original is free
+        auto snapshot = std::make_shared<cv::Mat>(uniform->clone());
+        harness.add({"restoreState" + suffix,
+                     nullptr,
+                     [processor, snapshot]() { processor->restoreState(*snapshot); },
+                     actualMegapixels});
+
+        harness.add({"resize/half" + suffix,
+                     [fixture, uniform]() { fixture->load(*uniform); },
+                     [processor, uniform]() { processor->resize(uniform->cols / 2, uniform->rows / 2); },
+                     actualMegapixels});
+
+        // Export encoding - noisy background so deflate has real work; the label carries the file size
+        if (megapixels <= MAX_ENCODE_MEGAPIXELS) {
+            auto photo = std::make_shared<cv::Mat>(syntheticImage(megapixels, Noisy));
+            auto encoded = std::make_shared<std::vector<uchar>>();
+            auto sizeLabel = [encoded]() { return QString("%1 MB").arg(encoded->size() / 1e6, 0, 'f', 2); };
+            harness.add({"encodePng/cv_imwrite" + suffix,
+                         nullptr,
+                         [photo, encoded]() {
+                             cv::imencode(".png", *photo, *encoded, {cv::IMWRITE_PNG_COMPRESSION, 6});
+                         },
+                         actualMegapixels,
+                         sizeLabel});
+            for (PngWriter::Preset preset : {PngWriter::Fast, PngWriter::Balanced, PngWriter::Small}) {
+                harness.add({"encodePng/" + PngWriter::presetName(preset) + suffix,
+                             nullptr,
+                             [photo, encoded, preset]() { PngWriter(preset).encode(*photo, *encoded); },
+                             actualMegapixels,
+                             sizeLabel});
+            }
+
+            // Other export formats against the same image - speed here, size in the label
+            struct FormatCase { QString name; QString format; int quality; };
+            std::vector<FormatCase> formats = {{"qoi", "qoi", 100}};
+            for (const QString& format : ImageProcessor::exportFormats()) {
+                if (!ImageProcessor::formatHasQuality(format)) continue;
+                formats.push_back({format + "-lossless", format, 100});
+                formats.push_back({format + "-q90", format, 90});
+            }
+            for (const FormatCase& format : formats) {
+                ExportOptions options;
+                options.quality = format.quality;
+                harness.add({"encode/" + format.name + suffix,
+                             nullptr,
+                             [photo, encoded, format, options]() {
+                                 ImageProcessor::encodeImage(*photo, format.format, options, *encoded);
+                             },
+                             actualMegapixels,
+                             sizeLabel});
+            }
+        }
+
+        if (haveModel && megapixels <= MAX_UPSCALE_MEGAPIXELS) {
+            auto opaqueAlpha = [upscaler]() { upscaler->setAlphaMode(Upscaler::AlphaBicubic); };
+            harness.add({"upscale/synthetic-x2" + suffix,
+                         opaqueAlpha,
+                         [upscaler, uniform]() { upscaler->upscale(*uniform, Upscaler::RealESRGAN_x2, 2); },
+                         actualMegapixels});
+            // The file-backed sink the batch tool uses for very large results
+            harness.add({"upscale/synthetic-x2/mapped" + suffix,
+                         opaqueAlpha,
+                         [upscaler, uniform, mappedPath]() {
+                             MappedFileUpscaleSink sink(mappedPath);
+                             upscaler->upscaleToSink(*uniform, Upscaler::RealESRGAN_x2, 2, sink);
+                         },
+                         actualMegapixels});
+
+            // Each alpha mode on a round cut-out - the label is the part spent on alpha
+            auto cutout = std::make_shared<cv::Mat>(uniform->clone());
+            cv::Mat mask(cutout->size(), CV_8U, cv::Scalar(0));
+            cv::circle(mask, cv::Point(mask.cols / 2, mask.rows / 2), std::min(mask.cols, mask.rows) / 3,
+                       cv::Scalar(255), cv::FILLED, cv::LINE_AA);
+            cv::insertChannel(mask, *cutout, 3);
+            const std::pair<QString, Upscaler::AlphaMode> alphaModes[] = {
+                {"bicubic", Upscaler::AlphaBicubic}, {"guided", Upscaler::AlphaGuided}, {"model", Upscaler::AlphaModel}};
+            for (const auto& mode : alphaModes) {
+                Upscaler::AlphaMode alphaMode = mode.second;
+                harness.add({"upscale/synthetic-x2/alpha:" + mode.first + suffix,
+                             [upscaler, alphaMode]() { upscaler->setAlphaMode(alphaMode); },
+                             [upscaler, cutout]() { upscaler->upscale(*cutout, Upscaler::RealESRGAN_x2, 2); },
+                             actualMegapixels,
+                             [upscaler]() {
+                                 return QString("alpha %1 s").arg(upscaler->lastStats().alphaSeconds, 0, 'f', 3);
+                             }});
+            }
+        }
+    }
+
+    harness.run();
+    QFile::remove(mappedPath);
+
+    if (parser.isSet(outOption) && !harness.writeJson(parser.value(outOption))) {
+        QTextStream(stderr) << "Could not write " << parser.value(outOption) << "\n";
+        return 1;
+    }
+    return 0;
+}
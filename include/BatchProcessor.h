@@ -0,0 +1,112 @@
+#ifndef BATCHPROCESSOR_H
+#define BATCHPROCESSOR_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "PngWriter.h"
+#include "Upscaler.h"
+
+class ImageProcessor;
+class QJsonObject;
+
+// Runs a scripted sequence of edits over many files without any widgets.
+// Files are spread over a bounded pool of workers, each holding one image at a time.
+class BatchProcessor {
+public:
+    struct Operation {
+        enum Type { AutoColor, Soften, Resize, Upscale, Export };
+        Type type = AutoColor;
+
+        // AutoColor - explicit seed points, or the four corners
+        std::vector<cv::Point> seeds;
+        bool cornerSeeds = false;
+        int tolerance = 30;
+
+        // Soften
+        int level = 0;
+
+        // Resize - either dimension may be 0 to keep the aspect ratio
+        int width = 0;
+        int height = 0;
+        double scale = 0.0;
+
+        // Upscale
+        Upscaler::Model model = Upscaler::RealESRGAN_x4;
+        Upscaler::AlphaMode alphaMode = Upscaler::AlphaBicubic;
+
+        // Export - written as <output>/<relative dir>/<base name><suffix>.<format>,
+        // or <base name><suffix>_<size>.<format> per longest side when sizes are given
+        QString format = "png";
+        QString suffix;
+        PngWriter::Preset compression = PngWriter::Balanced;
+        int quality = 100;                          // WebP and AVIF - 100 is lossless
+        std::vector<int> sizes;
+    };
+
+    struct StageStats {
+        QString name;
+        int images = 0;
+        double seconds = 0.0;                       // Summed over workers
+        double megapixels = 0.0;                    // Input size of each image at this stage
+    };
+
+    explicit BatchProcessor(Upscaler* upscaler);
+
+    // Script is JSON: {"operations": [{"op": "autoColor", "seeds": "corners", "tolerance": 20}, ...]}
+    bool loadScript(const QString& path);
+    const QVector<Operation>& operations() const { return m_operations; }
+    bool needsModel(Upscaler::Model model) const;
+
+    void setWorkerCount(int count);                 // 0 = auto from core count
+    int workerCount() const;
+
+    // Inputs are files or directories; returns the number of files that failed
+    int run(const QStringList& inputs, const QString& outputDir, bool recursive);
+
+    QVector<StageStats> stageStats() const;
+    int processedFiles() const { return m_processed.load(); }
+    double wallSeconds() const { return m_wallSeconds; }
+    QString errorString() const { return m_error; }
+
+    static QStringList supportedExtensions();
+
+private:
+    struct InputFile {
+        QString path;
+        QString relativeDir;                        // Kept under the output dir for directory inputs
+    };
+    std::vector<InputFile> collectInputs(const QStringList& inputs, bool recursive) const;
+    struct MappedResult;
+    bool processFile(const InputFile& file, const QString& outputDir);
+    bool applyOperation(const Operation& op, ImageProcessor& processor,
+                        const InputFile& file, const QString& outputDir,
+                        std::vector<std::unique_ptr<MappedResult>>& mapped);
+    void recordStage(int stage, double seconds, double megapixels);
+
+    static bool parseOperation(const QJsonObject& object, Operation& op, QString& error);
+    static QString operationName(Operation::Type type);
+
+    Upscaler* m_upscaler;
+    std::mutex m_upscaleMutex;                      // Upscaler already uses every core per image
+
+    QVector<Operation> m_operations;
+    int m_workerCount = 0;
+
+    mutable std::mutex m_statsMutex;
+    QVector<StageStats> m_stats;                    // Load, then one entry per operation
+    std::atomic<int> m_processed{0};
+    double m_wallSeconds = 0.0;
+    QString m_error;
+
+    static constexpr int MAX_AUTO_WORKERS = 8;      // Each worker keeps a full image plus its LAB cache
+    static constexpr qint64 MAPPED_UPSCALE_BYTES = qint64(2) << 30;  // Larger upscale results are file-backed
+};
+
+#endif // BATCHPROCESSOR_H
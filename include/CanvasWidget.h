@@ -5,13 +5,16 @@
 #include <QImage>
 #include <QPoint>
 #include <QRect>
+#include <QVector>
 #include <QKeyEvent>
 #include <QEnterEvent>
 #include <opencv2/opencv.hpp>
+#include <memory>
 
 class ImageProcessor;
 class ToolManager;
 class HistoryManager;
+class InteractionRecorder;
 
 class CanvasWidget : public QWidget {
     Q_OBJECT
@@ -26,6 +29,16 @@ public:
 
     void loadImage(const QString& path);
     void updateDisplay();
+    void updateRegions(const QVector<QRect>& imageRects);  // Refresh only changed areas (undo/redo)
+    
+    // Temporary tiles drawn over the image (upscale preview), any resolution
+    void showPreviewTile(const QRect& imageRect, const QImage& tile);
+    void clearPreviewTiles();
+
+    // Reduced decode shown stretched to the full image size while the real load finishes.
+    // Tools stay off until the processor has the image.
+    void showLoadingPreview(const QImage& preview, const QSize& imageSize);
+    void clearLoadingPreview();
 
     void zoomIn();
     void zoomOut();
@@ -43,6 +56,11 @@ public:
     void setCompareOpacity(double opacity);
     void setEdgeSoftening(int level);
 
+    // Log tool events to a file for pixeleraser-replay
+    bool startRecording(const QString& logPath, const QString& imagePath);
+    void stopRecording();
+    bool isRecording() const;
+
 signals:
     void zoomChanged(double zoom);
     void cursorPositionChanged(int x, int y);
@@ -69,6 +87,7 @@ private:
     void renderVisibleArea();
     void updateRegion(const QRect& imageRect);
     QRect imageRectToScreen(const QRect& imageRect) const;
+    QSize imageSize() const;  // Processor image, or the pending load while previewing
 
     QPoint screenToImage(const QPoint& screenPos) const;
     QPoint imageToScreen(const QPoint& imagePos) const;
@@ -80,11 +99,19 @@ private:
     ImageProcessor* m_processor = nullptr;
     ToolManager* m_toolManager = nullptr;
     HistoryManager* m_historyManager = nullptr;
+    std::unique_ptr<InteractionRecorder> m_recorder;
 
     QImage m_displayImage;
     QImage m_originalImage;
     QImage m_softenedImage;
     QImage m_blurredOriginal;  // Cached blurred original for compare
+    struct PreviewTile {
+        QRect imageRect;
+        QImage image;
+    };
+    QVector<PreviewTile> m_previewTiles;
+    QImage m_loadingPreview;
+    QSize m_loadingSize;
     double m_zoom = 1.0;
     QPointF m_panOffset;
     BackgroundType m_bgType = Dark;
@@ -8,9 +8,10 @@
 #include <QPushButton>
 #include <QImage>
 #include <QLineEdit>
+#include <QComboBox>
 #include <opencv2/opencv.hpp>
 
-class ImageProcessor;
+#include "ImageProcessor.h"
 
 class ExportDialog : public QDialog {
     Q_OBJECT
@@ -18,23 +19,38 @@ class ExportDialog : public QDialog {
 public:
     explicit ExportDialog(ImageProcessor* processor, QWidget* parent = nullptr);
     
+    // Starting values - the format follows the path's extension when it is one of ours
+    void setExportPath(const QString& path);
+    void setSofteningLevel(int level);
+    void setPngPreset(PngWriter::Preset preset);
+
     int getSofteningLevel() const { return m_softeningLevel; }
     QString getExportPath() const { return m_exportPath; }
+    QString getExportFormat() const { return selectedFormat(); }
+    ExportOptions getExportOptions() const;
 
 private slots:
     void onSofteningChanged(int level);
+    void onFormatChanged();
     void onBrowseClicked();
     void onExportClicked();
     void updatePreview();
 
 private:
     void setupUI();
+    QString selectedFormat() const;
+    QString withFormatSuffix(const QString& path) const;
     
     ImageProcessor* m_processor;
     
     QLabel* m_previewLabel;
     QSlider* m_softeningSlider;
     QLabel* m_softeningValueLabel;
+    QComboBox* m_formatCombo;
+    QWidget* m_pngPresetRow;
+    QComboBox* m_pngPresetCombo;
+    QSlider* m_qualitySlider;
+    QLabel* m_qualityValueLabel;
     QLineEdit* m_pathEdit;
     QPushButton* m_browseBtn;
     QPushButton* m_exportBtn;
@@ -0,0 +1,62 @@
+#ifndef EXPORTQUEUE_H
+#define EXPORTQUEUE_H
+
+#include <QObject>
+#include <QString>
+#include <QThreadPool>
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <vector>
+
+#include "ImageProcessor.h"
+
+// Runs exports in the background from copy-on-write snapshots, so editing carries on
+// while they soften, encode and write. Queued jobs run side by side, up to a limit.
+class ExportQueue : public QObject {
+    Q_OBJECT
+
+public:
+    enum Stage { Softening, Resizing, Encoding, Writing };
+    Q_ENUM(Stage)
+
+    struct Request {
+        QString path;                               // Format follows the extension
+        int softenLevel = 0;
+        ExportOptions options;
+        std::vector<int> longestSides;              // Several sizes instead of full size, one file each
+    };
+
+    explicit ExportQueue(QObject* parent = nullptr);
+    ~ExportQueue();                                 // Waits for running exports
+
+    // Shares the image's pixels - ImageProcessor copies them before its next edit
+    int enqueue(const cv::Mat& image, const Request& request);
+    int activeJobs() const { return m_active.load(); }
+
+    static QString stageName(Stage stage);
+
+signals:
+    // Emitted from worker threads - connect with the default (queued) connection
+    void progress(int jobId, ExportQueue::Stage stage, int percent);
+    void finished(int jobId, const QString& path, bool success);
+
+private:
+    struct Output {
+        QString path;
+        cv::Mat image;
+        std::vector<uchar> encoded;
+    };
+
+    bool run(int jobId, const cv::Mat& image, const Request& request);
+    bool encodeAll(int jobId, std::vector<Output>& outputs, const ExportOptions& options);
+    bool writeAll(int jobId, const std::vector<Output>& outputs);
+
+    QThreadPool m_pool;
+    std::atomic<int> m_active{0};
+    int m_lastJobId = 0;
+
+    static constexpr int MAX_CONCURRENT_EXPORTS = 3;
+    static constexpr qint64 WRITE_BLOCK_BYTES = 8 << 20;
+};
+
+#endif // EXPORTQUEUE_H
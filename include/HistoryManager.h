@@ -2,11 +2,13 @@
 #define HISTORYMANAGER_H
 
 #include <QObject>
+#include <QRect>
+#include <QVector>
 #include <opencv2/opencv.hpp>
 #include <vector>
 #include <memory>
 
-class ImageProcessor;
+#include "ImageProcessor.h"
 
 class HistoryManager : public QObject {
     Q_OBJECT
@@ -26,11 +28,12 @@ public:
     // Save initial state when image is loaded
     void saveInitialState();
 
-    // Undo/Redo
+    // Undo/Redo - return the image regions that changed so the caller
+    // can refresh only those (a single full-image rect after a resize/upscale)
     bool canUndo() const;
     bool canRedo() const;
-    void undo();
-    void redo();
+    QVector<QRect> undo();
+    QVector<QRect> redo();
 
     // Clear history
     void clear();
@@ -46,9 +49,15 @@ signals:
     void redoPerformed();
 
 private:
+    // Either a full snapshot (initial state, size-changing operations) or a
+    // tile delta holding the pixels of the touched tiles before and after the change
     struct HistoryState {
         cv::Mat imageState;
-        size_t memorySize;
+        std::vector<ImageProcessor::TilePatch> before;
+        std::vector<ImageProcessor::TilePatch> after;
+        size_t memorySize = 0;
+
+        bool isSnapshot() const { return !imageState.empty(); }
     };
 
     ImageProcessor* m_processor = nullptr;
@@ -59,6 +68,10 @@ private:
     static constexpr size_t MAX_MEMORY_MB = 2048; // Max 2GB for history (handles large images)
 
     void trimHistory();
+    void dropOldestState();
+    void discardRedoStates();
+    QVector<QRect> restoreIndex(int index);
+    QVector<QRect> fullImageRegion() const;
 };
 
 #endif // HISTORYMANAGER_H
@@ -4,9 +4,20 @@
 #include <opencv2/opencv.hpp>
 #include <QImage>
 #include <QString>
+#include <QStringList>
 #include <QRect>
+#include <QVector>
 #include <memory>
 #include <functional>
+#include <vector>
+
+#include "PngWriter.h"
+
+// Encoder settings for exports - each format reads the fields that apply to it
+struct ExportOptions {
+    PngWriter::Preset pngPreset = PngWriter::Balanced;
+    int quality = 100;                              // WebP and AVIF, 1-100 - 100 is lossless
+};
 
 class ImageProcessor {
 public:
@@ -15,14 +26,34 @@ public:
 
     // File operations
     bool loadImage(const QString& path);
+    static cv::Mat decodeImage(const QString& path);    // BGRA, thread-safe - for background loads
+    // Quick reduced-resolution decode (JPEG only) for showing something while decodeImage runs.
+    // Reports the full size from the file header; returns null when there is no fast path.
+    static QImage decodePreview(const QString& path, int maxSide, QSize* fullSize = nullptr);
     bool saveImage(const QString& path);
-    bool exportImage(const QString& path, int edgeSoftenLevel = 0);
+    bool exportImage(const QString& path, int edgeSoftenLevel = 0, const ExportOptions& options = {});
+    // One file per longest side, named by sizedPath - sizes not below the image are skipped
+    bool exportSizes(const QString& path, const std::vector<int>& longestSides, int edgeSoftenLevel = 0,
+                     const ExportOptions& options = {});
+    // Format follows the extension. PNG goes through PngWriter, QOI through QoiCodec,
+    // everything else through OpenCV's imgcodecs.
+    static bool writeImage(const QString& path, const cv::Mat& image, const ExportOptions& options = {});
+    static bool encodeImage(const cv::Mat& image, const QString& format, const ExportOptions& options,
+                            std::vector<uchar>& out);
+    // Lowercase extensions this build can export - png and qoi always, webp and avif when OpenCV has them
+    static QStringList exportFormats();
+    static QString formatFilter(const QString& format);    // "WebP Image (*.webp)"
+    static bool formatHasQuality(const QString& format);   // Lossy below quality 100
+    static QString sizedPath(const QString& path, int longestSide);  // photo.png -> photo_800.png
 
     // Image access
     QImage getDisplayImage() const;
     QImage getOriginalAsQImage() const;
+    // Target is Format_ARGB32_Premultiplied for display caches (premultiplied in the same pass)
+    // or Format_RGBA8888 for straight alpha
     void updateDisplayRegion(QImage& target, const QRect& region) const;
-    cv::Mat& getCurrentImage() { return m_currentImage; }
+    static QImage toDisplayImage(const cv::Mat& image);  // BGRA to ARGB32_Premultiplied
+    // Copying the header is a cheap snapshot - edits detach from any other holder first
     const cv::Mat& getCurrentImage() const { return m_currentImage; }
     const cv::Mat& getOriginalImage() const { return m_originalImage; }
 
@@ -32,8 +63,11 @@ public:
     bool hasImage() const { return !m_currentImage.empty(); }
     
     // Image operations
-    void resize(int newWidth, int newHeight);
-    void updateOriginalImage();  // Sync original with current (after upscale)
+    void resize(int newWidth, int newHeight);      // Lanczos - current and original resample together
+    // Downscales to each longest side, every level from the next larger one. Result matches the
+    // order of longestSides; sizes not below the image come back empty. Thread-safe.
+    static std::vector<cv::Mat> downscaleCascade(const cv::Mat& image, const std::vector<int>& longestSides);
+    void replaceImage(const cv::Mat& image);  // New current and original (after upscale), shared copy-on-write
     void clear();
 
     // Tools - viewport bounded
@@ -44,27 +78,52 @@ public:
     void repairAlongPath(const QPoint& start, const QPoint& end, int radius);
 
     // Edge softening for export
-    cv::Mat applySoftening(const cv::Mat& image, int level);
+    static cv::Mat applySoftening(const cv::Mat& image, int level);  // Thread-safe - exports run it off the GUI thread
 
     // State management
     cv::Mat captureState() const;
     void restoreState(const cv::Mat& state);
 
+    // Tile-level change tracking for undo/redo.
+    // Edit tools back up each tile the first time they touch it after a reset,
+    // so history can store only the pixels that actually changed.
+    struct TilePatch {
+        cv::Rect rect;
+        cv::Mat pixels;
+    };
+    void resetChangeTracking();
+    bool isWholeImageChanged() const;               // Image replaced (load/resize/upscale/restore)
+    std::vector<TilePatch> takeChangedTiles();      // Pre-change pixels of touched tiles
+    QVector<QRect> restoreTiles(const std::vector<TilePatch>& tiles);
+
     // Progress callback for long operations
     using ProgressCallback = std::function<void(int percent)>;
     void setProgressCallback(ProgressCallback callback) { m_progressCallback = callback; }
 
 private:
-    void ensureAlphaChannel(cv::Mat& image);
+    static cv::Mat decodeFile(const QString& path, int flags = cv::IMREAD_UNCHANGED);
+    static void ensureAlphaChannel(cv::Mat& image);
+    void detachCurrent();  // Give current its own pixels before an in-place edit if anything shares them
     QImage matToQImage(const cv::Mat& mat) const;
     bool colorMatches(const cv::Vec4b& c1, const cv::Vec4b& c2, int tolerance) const;
 
     cv::Mat m_originalImage;
     cv::Mat m_currentImage;
-    cv::Mat m_labImage;  // LAB color space cache for smart color matching
+    cv::Mat m_labImage;  // LAB color space cache for smart color matching, built on first use
     QImage m_qImageCache;
     
-    void updateLabCache();
+    void ensureLabCache();
+    void updateLabRegion(const cv::Rect& rect);
+
+    // Backs up every untouched tile in [minX..maxX] x [minY..maxY] before it is modified
+    void backupTiles(int minX, int minY, int maxX, int maxY);
+
+    std::vector<uchar> m_touchedTiles;      // One flag per CHANGE_TILE_SIZE tile
+    std::vector<TilePatch> m_tileBackups;
+    int m_trackedTilesX = 0;
+    bool m_imageReplaced = true;
+
+    static constexpr int CHANGE_TILE_SIZE = 256;
 
     ProgressCallback m_progressCallback;
 };
@@ -0,0 +1,59 @@
+#ifndef INTERACTIONLOG_H
+#define INTERACTIONLOG_H
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QPoint>
+#include <QRect>
+#include <QString>
+#include <QVector>
+
+// One tool event as the canvas applied it, in image coordinates
+struct InteractionEvent {
+    enum Type { AutoColor, StrokeBegin, StrokeMove, StrokeEnd, Undo, Redo };
+    enum Tool { Erase, Repair };
+
+    Type type = AutoColor;
+    qint64 timeMs = 0;                              // Since recording started
+    QPoint pos;
+    Tool tool = Erase;                              // StrokeBegin only - moves reuse it
+    int brushSize = 0;                              // StrokeBegin only
+    float hardness = 0.8f;                          // StrokeBegin only
+    int tolerance = 0;                              // AutoColor only
+    QRect viewport;                                 // AutoColor only - bounds the fill
+
+    static QString typeName(Type type);
+};
+
+// Session recording - a JSON header line, then one JSON event per line
+struct InteractionLog {
+    QString imagePath;
+    int width = 0;
+    int height = 0;
+    QVector<InteractionEvent> events;
+
+    bool load(const QString& path, QString* error = nullptr);
+};
+
+// Appends events to a log file as they happen, flushed per line so a crash keeps the session
+class InteractionRecorder {
+public:
+    bool start(const QString& path, const QString& imagePath, int width, int height);
+    void stop();
+    bool isRecording() const { return m_file.isOpen(); }
+
+    void autoColor(const QPoint& pos, int tolerance, const QRect& viewport);
+    void strokeBegin(InteractionEvent::Tool tool, const QPoint& pos, int brushSize, float hardness);
+    void strokeMove(const QPoint& pos);
+    void strokeEnd();
+    void undo();
+    void redo();
+
+private:
+    void write(InteractionEvent event);
+
+    QFile m_file;
+    QElapsedTimer m_clock;
+};
+
+#endif // INTERACTIONLOG_H
@@ -0,0 +1,57 @@
+#ifndef INTERACTIONREPLAYER_H
+#define INTERACTIONREPLAYER_H
+
+#include <QImage>
+#include <QString>
+#include <QVector>
+
+#include "InteractionLog.h"
+
+class ImageProcessor;
+class HistoryManager;
+
+// Drives ImageProcessor and HistoryManager through a recorded session headlessly,
+// making the same engine calls as CanvasWidget, and times each event.
+class InteractionReplayer {
+public:
+    struct EventStats {
+        QString name;
+        int count = 0;
+        double p50Ms = 0.0;
+        double p90Ms = 0.0;
+        double p99Ms = 0.0;
+        double maxMs = 0.0;
+        double totalMs = 0.0;
+    };
+
+    struct Report {
+        QVector<EventStats> events;                 // One entry per event type seen, plus "all"
+        double totalMs = 0.0;
+        size_t peakRssBytes = 0;
+    };
+
+    InteractionReplayer(ImageProcessor* processor, HistoryManager* history);
+
+    // Sleep between events to match the recorded timing (e.g. to exercise idle work)
+    void setPaced(bool paced) { m_paced = paced; }
+
+    // Image must already be loaded into the processor
+    Report replay(const InteractionLog& log);
+
+    static size_t peakResidentBytes();
+
+private:
+    void apply(const InteractionEvent& event);
+    void refreshDisplay(const QRect& imageRect);
+
+    ImageProcessor* m_processor;
+    HistoryManager* m_history;
+    QImage m_displayImage;                          // Stands in for the canvas display cache
+    bool m_paced = false;
+
+    // Stroke state carried between events, as in CanvasWidget
+    InteractionEvent m_stroke;
+    QPoint m_lastStrokePos;
+};
+
+#endif // INTERACTIONREPLAYER_H
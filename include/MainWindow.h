@@ -14,12 +14,20 @@
 #include <QPushButton>
 #include <QCloseEvent>
 #include <QProgressBar>
+#include <QElapsedTimer>
+#include <QHash>
+#include <vector>
+
+#include "PngWriter.h"
 
 class CanvasWidget;
 class ImageProcessor;
 class ToolManager;
 class HistoryManager;
 class UpdateChecker;
+class Upscaler;
+class ExportQueue;
+struct ExportOptions;
 
 class MainWindow : public QMainWindow {
     Q_OBJECT
@@ -32,6 +40,7 @@ private slots:
     void openFile();
     void discardImage();
     void quickExport();
+    void exportSizes();
     void exportFile();
     void resizeImage();
     void upscaleImage();
@@ -45,6 +54,9 @@ private slots:
     void toggleSidebar();
     void showShortcuts();
     void checkForUpdates();
+    void toggleSessionRecording();
+    void onExportProgress(int jobId, int stage, int percent);
+    void onExportFinished(int jobId, const QString& path, bool success);
     void onUpdateAvailable(const QString& version, const QString& downloadUrl, const QString& notes);
     void onNoUpdateAvailable();
     void onUpdateCheckFailed(const QString& error);
@@ -60,6 +72,7 @@ protected:
 
 private:
     void setupMenuBar();
+    void stopSessionRecording();
     void setupToolBar();
     void setupToolPanel();
     void setupStatusBar();
@@ -69,12 +82,20 @@ private:
     bool confirmSaveBeforeClose();
     QWidget* createSeparator();
     void showProgress(bool show, const QString& message = QString());
+    void updateExportProgress();
+    QString defaultExportPath() const;
+    // Save dialog with one filter per export format; asks for quality when the format has one
+    QString chooseExportPath(const QString& title, int& quality);
+    void startExport(const QString& path, const ExportOptions& options, int softenLevel,
+                     const std::vector<int>& longestSides = {});
 
     CanvasWidget* m_canvas;
     ImageProcessor* m_processor;
     ToolManager* m_toolManager;
     HistoryManager* m_historyManager;
     UpdateChecker* m_updateChecker;
+    Upscaler* m_upscaler;  // Long-lived so model sessions stay warm between upscales
+    ExportQueue* m_exportQueue;
 
     QDockWidget* m_toolDock;
     QSlider* m_brushSizeSlider;
@@ -98,9 +119,29 @@ private:
     QAction* m_compareAction;
     QAction* m_toggleSidebarAction;
     QAction* m_toggleSidebarBtn;
+    QAction* m_recordSessionAction;
     
     bool m_isComparing = false;
     QString m_currentFilePath;
+
+    // Background open - preview first, editing enabled once the full decode lands
+    bool m_isLoading = false;
+    QElapsedTimer m_loadTimer;
+    qint64 m_loadPreviewMs = -1;
+
+    // Running exports by job id, for the progress bar
+    struct ExportStatus {
+        QString fileName;
+        QString stage;
+        int percent = 0;  // Across all stages
+        int files = 1;
+    };
+    QHash<int, ExportStatus> m_exports;
+    QString m_exportFormat = "png";  // Last format chosen, offered first next time
+    int m_upscaleAlphaMode = 0;      // Upscaler::AlphaMode last chosen for a cut-out
+    PngWriter::Preset m_pngPreset = PngWriter::Balanced;  // Last chosen in the export dialog
+
+    static constexpr int LOAD_PREVIEW_MAX_SIDE = 2048;  // Enough to fill the canvas at fit zoom
 };
 
 #endif // MAINWINDOW_H
@@ -0,0 +1,24 @@
+#ifndef QOICODEC_H
+#define QOICODEC_H
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+// "Quite OK Image" format (qoiformat.org) - lossless, one pass, several times faster
+// than PNG at a somewhat larger size. Meant for intermediate saves and pipelines.
+class QoiCodec {
+public:
+    // 8-bit BGR or BGRA; gray is stored as RGB
+    static bool encode(const cv::Mat& image, std::vector<uchar>& out);
+    // BGRA or BGR, matching the channel count in the header; empty when invalid
+    static cv::Mat decode(const uchar* data, size_t size);
+
+    static bool isQoi(const uchar* data, size_t size);
+
+private:
+    static constexpr int HEADER_SIZE = 14;
+    static constexpr int PADDING_SIZE = 8;
+    static constexpr unsigned MAX_PIXELS = 400000000;   // Spec limit - keeps the worst case in 32-bit
+};
+
+#endif // QOICODEC_H
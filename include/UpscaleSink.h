@@ -0,0 +1,63 @@
+#ifndef UPSCALESINK_H
+#define UPSCALESINK_H
+
+#include <QFile>
+#include <QString>
+#include <opencv2/opencv.hpp>
+
+// Destination for upscaled pixels. The upscaler fills the output one
+// horizontal band at a time, top to bottom, so a sink only needs the band
+// currently being written to be resident in memory.
+class UpscaleSink {
+public:
+    virtual ~UpscaleSink() = default;
+
+    virtual bool begin(int width, int height, int type) = 0;
+    
+    // Writable buffer for output rows [y, y + rows)
+    virtual cv::Mat bandBuffer(int y, int rows) = 0;
+    
+    // Rows [y, y + rows) are complete
+    virtual bool commitBand(int y, int rows) = 0;
+    
+    virtual bool finish() = 0;
+};
+
+// Keeps the whole result in memory
+class MatUpscaleSink : public UpscaleSink {
+public:
+    bool begin(int width, int height, int type) override;
+    cv::Mat bandBuffer(int y, int rows) override;
+    bool commitBand(int y, int rows) override;
+    bool finish() override;
+
+    cv::Mat result() const { return m_image; }
+
+private:
+    cv::Mat m_image;
+};
+
+// Headerless raw pixels in a memory-mapped file. The OS pages finished bands
+// out to disk, so results larger than RAM (4x of a 24 MP photo is ~25 GB)
+// remain feasible.
+class MappedFileUpscaleSink : public UpscaleSink {
+public:
+    explicit MappedFileUpscaleSink(const QString& path);
+    ~MappedFileUpscaleSink() override;
+
+    bool begin(int width, int height, int type) override;
+    cv::Mat bandBuffer(int y, int rows) override;
+    bool commitBand(int y, int rows) override;
+    bool finish() override;
+
+    // Mapped result - valid until the sink is destroyed
+    cv::Mat image() const { return m_image; }
+    QString errorString() const { return m_file.errorString(); }
+
+private:
+    QFile m_file;
+    uchar* m_mapped = nullptr;
+    cv::Mat m_image;
+};
+
+#endif // UPSCALESINK_H
@@ -3,8 +3,21 @@
 
 #include <QString>
 #include <QObject>
+#include <QHash>
+#include <QImage>
+#include <QRect>
+#include <QVector>
 #include <opencv2/opencv.hpp>
+#include <atomic>
+#include <functional>
+#include <list>
 #include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+class QTimer;
+class UpscaleSink;
 
 class Upscaler : public QObject {
     Q_OBJECT
@@ -16,36 +29,209 @@ public:
         RealESRGAN_x4_anime  // 4x upscaling - optimized for anime/illustrations
     };
 
+    // Weight formats - reduced-precision variants are optional files next to the FP32 model
+    enum Precision {
+        PrecisionAuto,  // INT8 with VNNI, FP16 with AVX-512 - if a precision report passes them - else FP32
+        PrecisionFP32,
+        PrecisionFP16,  // FP16 weights, float32 I/O
+        PrecisionINT8   // Dynamic or static QDQ quantised, float32 I/O
+    };
+
+    // How the alpha channel of RGBA input is upscaled
+    enum AlphaMode {
+        AlphaBicubic,   // Plain bicubic resize - cheapest, soft cut-out edges
+        AlphaGuided,    // Bicubic refined by a guided filter on the upscaled colour
+        AlphaModel      // Through the network as a grey tile, batched with the colour tiles
+    };
+
     explicit Upscaler(QObject* parent = nullptr);
     ~Upscaler();
 
     // Check if model is downloaded
     bool isModelAvailable(Model model);
-    
+
+    bool isVariantAvailable(Model model, Precision precision);
+    void setPrecision(Precision precision);
+    Precision resolvePrecision(Model model);        // Variant the next upscale will use
+
     // Download model if not available - callback receives (bytesReceived, bytesTotal)
     bool downloadModel(Model model, std::function<void(qint64, qint64)> progressCallback = nullptr);
-    
-    // Upscale image
+
+    // Upscale image - falls back to bicubic if the model can't run
     cv::Mat upscale(const cv::Mat& input, Model model, int scale = 4);
     
+    // Upscale into a sink band by band (8-bit BGRA when the input has alpha, else BGR).
+    // Peak memory is a few tile rows plus whatever the sink keeps.
+    bool upscaleToSink(const cv::Mat& input, Model model, int scale, UpscaleSink& sink);
+    
+    // Cancel the running upscale - safe from any thread. Stops between tiles and
+    // terminates inference runs already in flight.
+    void cancel();
+    bool wasCancelled() const { return m_cancelRequested.load(); }
+    
+    void setAlphaMode(AlphaMode mode);
+    
+    // Emit tilePreviewReady for each finished tile
+    void setTilePreviewEnabled(bool enabled);
+    
+    // Called on the worker thread right before (true) and after (false) every
+    // inference Run - tells ONNX Runtime's own work from the pipeline around it
+    void setRunObserver(std::function<void(bool running)> observer);
+
+    // Tile scheduling - several tiles run concurrently, each on its own session
+    void setMaxConcurrentTiles(int count);          // 0 = auto from core count
+    void setMaxBatchSize(int count);                // Tiles per Run on dynamic-batch models, 0 = auto
+    void setTileOverlap(int pixels);                // Feathered overlap between neighbouring tiles
+    void setTileSize(int pixels);                   // 0 = calibrated per model and machine, odd rounds up
+    void clearTileCalibration();                    // Re-benchmark tile sizes on next upscale
+
+    struct UpscaleStats {
+        int tiles = 0;                              // Tiles run through the network
+        int skippedTiles = 0;                       // Transparent tiles filled without inference
+        int concurrency = 0;
+        int intraOpThreads = 0;
+        int batchSize = 1;
+        int tileSize = 0;
+        Precision precision = PrecisionFP32;
+        AlphaMode alphaMode = AlphaBicubic;
+        double alphaSeconds = 0.0;                  // Spent outside the network on alpha
+        double seconds = 0.0;
+        double tilesPerSecond = 0.0;
+    };
+    UpscaleStats lastStats() const;                 // Throughput of the most recent upscale
+
+    // Speed and quality of every available variant against FP32 on a sample image.
+    // Saved next to the model - automatic selection only picks variants it passes.
+    struct PrecisionReport {
+        Precision precision = PrecisionFP32;
+        double seconds = 0.0;
+        double speedup = 1.0;
+        double psnr = 0.0;                          // dB against the FP32 output
+    };
+    QVector<PrecisionReport> benchmarkPrecisions(Model model, const cv::Mat& sample);
+    static bool passesPrecisionReport(const PrecisionReport& report);  // Fast enough and close to FP32
+
+    // Session cache - loaded models stay warm between upscales
+    void setIdleTimeout(int msec);                  // Free sessions after this long unused (0 = never)
+    void setOptimizedModelCacheEnabled(bool enabled); // Serialise optimised graph next to the model
+    void unloadModel();                             // Drop all cached sessions now
+
     // Get model info
     static QString getModelName(Model model);
     static QString getModelDescription(Model model);
     static QString getModelUrl(Model model);
     static int getModelScale(Model model);
+    static QString getPrecisionName(Precision precision);
 
 signals:
     void progressChanged(int percent);
+    void tilePreviewReady(const QRect& inputRect, const QImage& tile);  // Emitted from worker threads
     void error(const QString& message);
 
 private:
-    QString getModelPath(Model model);
-    bool loadModel(Model model);
-    void unloadModel();
-    
+    QString getModelPath(Model model, Precision precision = PrecisionFP32);
+    QString getOptimizedModelPath(const QString& modelPath);
+    QString getPrecisionReportPath(Model model);
+
     struct OnnxSession;
-    std::unique_ptr<OnnxSession> m_session;
-    Model m_currentModel = RealESRGAN_x4;
+    struct SessionPool;
+    struct ThreadPlan {
+        int concurrency = 1;
+        int intraOpThreads = 1;
+    };
+    ThreadPlan planThreads(int tileCount) const;
+    std::vector<std::shared_ptr<OnnxSession>> acquireSessions(const QString& modelPath, const ThreadPlan& plan);
+    std::shared_ptr<OnnxSession> createSession(const QString& modelPath, int intraOpThreads);
+    int chooseBatchSize(cv::Size tileSize, int scale, int concurrency) const;
+    static size_t tileWorkingSetBytes(cv::Size tensorSize, int scale);
+    struct TileBuffers;
+    struct TileLayout {
+        int tileSize = DEFAULT_TILE_SIZE;
+        int overlap = DEFAULT_TILE_OVERLAP;     // Input pixels each tile extends into its neighbours
+        cv::Size tensorSize;                    // Padded tile shape fed to the model
+        int scale = 4;
+    };
+    struct TileJob {
+        cv::Point origin;
+        bool alpha = false;                     // Alpha plane replicated to RGB (AlphaModel)
+        bool half = false;                      // Quadrant of a mostly transparent tile
+    };
+    static TileLayout makeLayout(cv::Size imageSize, int tileSize, int overlap, int scale);
+    static cv::Rect tileRegion(cv::Point origin, cv::Size imageSize, const TileLayout& layout);
+    void bindBuffers(OnnxSession& session, TileBuffers& buffers, int batch,
+                     cv::Size tensorSize, int scale);
+    void runBatch(OnnxSession& session, TileBuffers& buffers, const cv::Mat& source,
+                  const cv::Mat& alpha, const TileJob* jobs, int count, const TileLayout& layout);
+    static void featherWeights(int coreStart, int coreEnd, int extentStart, int extentEnd,
+                               int imageEnd, int overlap, int scale, std::vector<float>& weights);
+    static cv::Rect featherTile(cv::Point origin, cv::Size inputSize, const TileLayout& layout,
+                                std::vector<float>& rowWeights, std::vector<float>& colWeights);
+    static void fillTile(const cv::Mat& source, cv::Point origin, const TileLayout& layout,
+                         TileBuffers& scratch, cv::Mat* accumulator, int accumulatorY);
+    static void scheduleTile(const cv::Mat& alpha, cv::Point origin, const TileLayout& layout,
+                             const TileLayout* halfLayout, bool alphaTiles,
+                             std::vector<TileJob>& jobs, std::vector<TileJob>& fills);
+    void blendBatch(TileBuffers& buffers, const TileJob* jobs, int count,
+                    cv::Size inputSize, const TileLayout& layout, cv::Mat* accumulator,
+                    int accumulatorY, std::mutex& accumulatorMutex);
+    static cv::Mat upscaleAlphaBand(const cv::Mat& alpha, int y, int rows, int scale, cv::Mat& storage);
+    void emitTilePreviews(const TileBuffers& buffers, const TileJob* jobs, int count,
+                          const cv::Mat& source, const TileLayout& layout, double previewScale);
+    bool verifyBatching(OnnxSession& session, const cv::Mat& source, const cv::Mat& alpha,
+                        const TileJob* jobs, int count, const TileLayout& layout);
+
+    // Tile size calibration - benchmarked once per model and machine, cached on disk
+    int cachedTileSize(const QString& modelPath);
+    int calibrateTileSize(const QString& modelPath, OnnxSession& session, int scale, int overlap, int workers);
+    QString calibrationKey(const QString& modelPath);
+    QString getCalibrationPath() const;
+    void scheduleIdleRelease();
+
+    // Most recently used first, keyed by model file (x4 and x4 anime share one)
+    std::list<SessionPool> m_sessionPools;
+    std::mutex m_sessionMutex;
+    QTimer* m_idleTimer;
+    std::atomic<int> m_activeJobs{0};
+    bool m_optimizedCacheEnabled = true;
+    int m_maxConcurrentTiles = 0;
+    int m_maxBatchSize = 0;
+    int m_tileOverlap = DEFAULT_TILE_OVERLAP;
+    int m_tileSizeOverride = 0;
+    Precision m_precision = PrecisionAuto;
+    AlphaMode m_alphaMode = AlphaBicubic;
+    bool m_previewEnabled = false;
+    std::function<void(bool)> m_runObserver;
+
+    // Buffers of runs in flight, so cancel() can terminate them
+    std::atomic<bool> m_cancelRequested{false};
+    std::mutex m_activeRunMutex;
+    std::vector<TileBuffers*> m_activeRuns;
+    struct ActiveRun;                               // Registers buffers in m_activeRuns while alive
+
+    std::mutex m_calibrationMutex;
+    QHash<QString, int> m_calibratedTileSizes;      // Model path -> calibrated tile size
+
+    mutable std::mutex m_statsMutex;
+    UpscaleStats m_lastStats;
+
+    static constexpr int DEFAULT_TILE_SIZE = 256;
+    static constexpr int DEFAULT_TILE_OVERLAP = 16;
+    static constexpr int MIN_TILE_SIZE = 64;        // Smallest quadrant worth a separate tile
+    static constexpr int TILE_SIZE_CANDIDATES[] = {128, 192, 256, 384, 512, 768};
+    static constexpr double PREVIEW_MAX_PIXELS = 64.0 * 1000 * 1000;  // Cap on total preview size
+    static constexpr int ALPHA_CONTEXT_ROWS = 3;    // Source rows past a band that bicubic alpha reads
+    static constexpr int GUIDED_RADIUS = 2;         // Input pixels, multiplied by the scale
+    static constexpr double GUIDED_EPS = 1e-3;
+    static constexpr double MIN_VARIANT_PSNR = 35.0;  // dB against FP32 below which auto skips a variant
+    static constexpr double CALIBRATION_FALLOFF = 0.9;  // Stop once a size is this much slower than the best
+    static constexpr int TARGET_INTRA_OP_THREADS = 4;
+    static constexpr int MAX_BATCH_SIZE = 8;
+    static constexpr int FEATURE_CHANNELS = 64;     // Real-ESRGAN feature width
+    static constexpr int LIVE_FEATURE_MAPS = 8;     // Feature maps alive at once inside an RRDB block
+    static constexpr double BATCH_TOLERANCE = 1e-3;
+    enum BatchCheck { BatchUnchecked, BatchVerified, BatchUnsupported };
+    static constexpr size_t MAX_CACHED_MODELS = 2;
+    static constexpr int DEFAULT_IDLE_TIMEOUT_MS = 5 * 60 * 1000;
 };
 
 #endif // UPSCALER_H
@@ -0,0 +1,388 @@
+#include "BatchProcessor.h"
+#include "ImageProcessor.h"
+#include "UpscaleSink.h"
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryFile>
+#include <QThread>
+#include <QDebug>
+#include <algorithm>
+#include <thread>
+
+// Upscale output mapped from a temporary file, alive while the image still uses it
+struct BatchProcessor::MappedResult {
+    QTemporaryFile file;
+    std::unique_ptr<MappedFileUpscaleSink> sink;    // Declared last - unmapped before the file is removed
+};
+
+BatchProcessor::BatchProcessor(Upscaler* upscaler)
+    : m_upscaler(upscaler)
+{
+}
+
+QStringList BatchProcessor::supportedExtensions() {
+    return {"png", "jpg", "jpeg", "bmp", "tif", "tiff", "webp", "qoi"};
+}
+
+QString BatchProcessor::operationName(Operation::Type type) {
+    switch (type) {
+        case Operation::AutoColor: return "autoColor";
+        case Operation::Soften: return "soften";
+        case Operation::Resize: return "resize";
+        case Operation::Upscale: return "upscale";
+        case Operation::Export: return "export";
+    }
+    return "unknown";
+}
+
+bool BatchProcessor::parseOperation(const QJsonObject& object, Operation& op, QString& error) {
+    QString name = object.value("op").toString();
+
+    if (name == "autoColor") {
+        op.type = Operation::AutoColor;
+        op.tolerance = object.value("tolerance").toInt(op.tolerance);
+        QJsonValue seeds = object.value("seeds");
+        if (seeds.isString() && seeds.toString() == "corners") {
+            op.cornerSeeds = true;
+        } else if (seeds.isArray()) {
+            for (const QJsonValue& seed : seeds.toArray()) {
+                QJsonArray point = seed.toArray();
+                if (point.size() != 2) {
+                    error = "autoColor seeds must be [x, y] pairs";
+                    return false;
+                }
+                op.seeds.emplace_back(point[0].toInt(), point[1].toInt());
+            }
+        }
+        if (!op.cornerSeeds && op.seeds.empty()) {
+            error = "autoColor needs \"seeds\": \"corners\" or a list of [x, y] points";
+            return false;
+        }
+    } else if (name == "soften") {
+        op.type = Operation::Soften;
+        op.level = std::clamp(object.value("level").toInt(1), 0, 5);
+    } else if (name == "resize") {
+        op.type = Operation::Resize;
+        op.width = object.value("width").toInt();
+        op.height = object.value("height").toInt();
+        op.scale = object.value("scale").toDouble();
+        if (op.width <= 0 && op.height <= 0 && op.scale <= 0.0) {
+            error = "resize needs \"width\", \"height\" or \"scale\"";
+            return false;
+        }
+    } else if (name == "upscale") {
+        op.type = Operation::Upscale;
+        QString model = object.value("model").toString("x4");
+        if (model == "x2") {
+            op.model = Upscaler::RealESRGAN_x2;
+        } else if (model == "x4") {
+            op.model = Upscaler::RealESRGAN_x4;
+        } else if (model == "x4-anime") {
+            op.model = Upscaler::RealESRGAN_x4_anime;
+        } else {
+            error = "upscale model must be x2, x4 or x4-anime";
+            return false;
+        }
+        QString alpha = object.value("alpha").toString("bicubic");
+        if (alpha == "bicubic") {
+            op.alphaMode = Upscaler::AlphaBicubic;
+        } else if (alpha == "guided") {
+            op.alphaMode = Upscaler::AlphaGuided;
+        } else if (alpha == "model") {
+            op.alphaMode = Upscaler::AlphaModel;
+        } else {
+            error = "upscale alpha must be bicubic, guided or model";
+            return false;
+        }
+    } else if (name == "export") {
+        op.type = Operation::Export;
+        op.format = object.value("format").toString(op.format).toLower();
+        op.suffix = object.value("suffix").toString();
+        QString compression = object.value("compression").toString(PngWriter::presetName(op.compression));
+        if (!PngWriter::presetFromName(compression, op.compression)) {
+            error = "export compression must be fast, balanced or small";
+            return false;
+        }
+        op.quality = object.value("quality").toInt(op.quality);
+        if (op.quality < 1 || op.quality > 100) {
+            error = "export quality must be 1-100";
+            return false;
+        }
+        for (const QJsonValue& size : object.value("sizes").toArray()) {
+            if (size.toInt() <= 0) {
+                error = "export sizes must be positive pixel counts";
+                return false;
+            }
+            op.sizes.push_back(size.toInt());
+        }
+    } else {
+        error = QString("Unknown operation \"%1\"").arg(name);
+        return false;
+    }
+    return true;
+}
+
+bool BatchProcessor::loadScript(const QString& path) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        m_error = "Cannot open script: " + file.errorString();
+        return false;
+    }
+
+    QJsonParseError parseError;
+    QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &parseError);
+    if (doc.isNull()) {
+        m_error = "Invalid script: " + parseError.errorString();
+        return false;
+    }
+
+    QVector<Operation> operations;
+    const QJsonArray array = doc.object().value("operations").toArray();
+    for (int i = 0; i < array.size(); ++i) {
+        Operation op;
+        QString error;
+        if (!parseOperation(array[i].toObject(), op, error)) {
+            m_error = QString("Operation %1: %2").arg(i + 1).arg(error);
+            return false;
+        }
+        operations.append(op);
+    }
+
+    if (operations.isEmpty()) {
+        m_error = "Script has no operations";
+        return false;
+    }
+    if (operations.last().type != Operation::Export) {
+        m_error = "Script must end with an export operation";
+        return false;
+    }
+
+    m_operations = operations;
+    return true;
+}
+
+bool BatchProcessor::needsModel(Upscaler::Model model) const {
+    return std::any_of(m_operations.begin(), m_operations.end(), [model](const Operation& op) {
+        return op.type == Operation::Upscale && op.model == model;
+    });
+}
+
+void BatchProcessor::setWorkerCount(int count) {
+    m_workerCount = std::max(0, count);
+}
+
+int BatchProcessor::workerCount() const {
+    if (m_workerCount > 0) return m_workerCount;
+    return std::clamp(QThread::idealThreadCount(), 1, MAX_AUTO_WORKERS);
+}
+
+std::vector<BatchProcessor::InputFile> BatchProcessor::collectInputs(const QStringList& inputs,
+                                                                     bool recursive) const {
+    QStringList filters;
+    for (const QString& ext : supportedExtensions()) {
+        filters << "*." + ext << "*." + ext.toUpper();
+    }
+
+    std::vector<InputFile> files;
+    for (const QString& input : inputs) {
+        QFileInfo info(input);
+        if (info.isFile()) {
+            files.push_back({info.absoluteFilePath(), QString()});
+            continue;
+        }
+        if (!info.isDir()) {
+            qWarning() << "Skipping missing input:" << input;
+            continue;
+        }
+
+        QDir root(info.absoluteFilePath());
+        QDirIterator it(root.absolutePath(), filters, QDir::Files,
+                        recursive ? QDirIterator::Subdirectories : QDirIterator::NoIteratorFlags);
+        std::vector<InputFile> found;
+        while (it.hasNext()) {
+            QString path = it.next();
+            found.push_back({path, root.relativeFilePath(QFileInfo(path).absolutePath())});
+        }
+        // Stable order so reruns touch files in the same sequence
+        std::sort(found.begin(), found.end(), [](const InputFile& a, const InputFile& b) {
+            return a.path < b.path;
+        });
+        files.insert(files.end(), found.begin(), found.end());
+    }
+    return files;
+}
+
+int BatchProcessor::run(const QStringList& inputs, const QString& outputDir, bool recursive) {
+    std::vector<InputFile> files = collectInputs(inputs, recursive);
+
+    {
+        std::lock_guard<std::mutex> lock(m_statsMutex);
+        m_stats.clear();
+        StageStats load;
+        load.name = "load";
+        m_stats.append(load);
+        for (int i = 0; i < m_operations.size(); ++i) {
+            StageStats stage;
+            stage.name = QString("%1. %2").arg(i + 1).arg(operationName(m_operations[i].type));
+            m_stats.append(stage);
+        }
+    }
+    m_processed = 0;
+
+    QElapsedTimer wallTimer;
+    wallTimer.start();
+
+    std::atomic<size_t> nextFile{0};
+    std::atomic<int> failures{0};
+    auto worker = [&]() {
+        size_t index;
+        while ((index = nextFile.fetch_add(1)) < files.size()) {
+            if (processFile(files[index], outputDir)) {
+                m_processed++;
+            } else {
+                failures++;
+            }
+        }
+    };
+
+    int workers = std::min<int>(workerCount(), static_cast<int>(files.size()));
+    std::vector<std::thread> threads;
+    for (int i = 1; i < workers; ++i) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    m_wallSeconds = wallTimer.nsecsElapsed() / 1e9;
+    return failures.load();
+}
+
+bool BatchProcessor::processFile(const InputFile& file, const QString& outputDir) {
+    std::vector<std::unique_ptr<MappedResult>> mapped;  // Outlives the processor holding its pixels
+    ImageProcessor processor;
+    QElapsedTimer timer;
+
+    timer.start();
+    if (!processor.loadImage(file.path)) {
+        qWarning() << "Failed to load" << file.path;
+        return false;
+    }
+    recordStage(0, timer.nsecsElapsed() / 1e9,
+                processor.getWidth() * static_cast<double>(processor.getHeight()) / 1e6);
+
+    for (int i = 0; i < m_operations.size(); ++i) {
+        double megapixels = processor.getWidth() * static_cast<double>(processor.getHeight()) / 1e6;
+        timer.restart();
+        if (!applyOperation(m_operations[i], processor, file, outputDir, mapped)) {
+            qWarning() << "Operation" << operationName(m_operations[i].type) << "failed on" << file.path;
+            return false;
+        }
+        recordStage(i + 1, timer.nsecsElapsed() / 1e9, megapixels);
+    }
+    return true;
+}
+
+bool BatchProcessor::applyOperation(const Operation& op, ImageProcessor& processor,
+                                    const InputFile& file, const QString& outputDir,
+                                    std::vector<std::unique_ptr<MappedResult>>& mapped) {
+    switch (op.type) {
+        case Operation::AutoColor: {
+            std::vector<cv::Point> seeds = op.seeds;
+            if (op.cornerSeeds) {
+                int right = processor.getWidth() - 1;
+                int bottom = processor.getHeight() - 1;
+                seeds = {{0, 0}, {right, 0}, {0, bottom}, {right, bottom}};
+            }
+            // Seeds already cleared by an earlier one are skipped by autoColorRemove
+            for (const cv::Point& seed : seeds) {
+                processor.autoColorRemove(seed.x, seed.y, op.tolerance, QRect());
+            }
+            return true;
+        }
+        case Operation::Soften:
+            processor.replaceImage(processor.applySoftening(processor.getCurrentImage(), op.level));
+            return true;
+        case Operation::Resize: {
+            int width = op.width;
+            int height = op.height;
+            if (op.scale > 0.0) {
+                width = cvRound(processor.getWidth() * op.scale);
+                height = cvRound(processor.getHeight() * op.scale);
+            } else if (width <= 0) {
+                width = cvRound(processor.getWidth() * static_cast<double>(height) / processor.getHeight());
+            } else if (height <= 0) {
+                height = cvRound(processor.getHeight() * static_cast<double>(width) / processor.getWidth());
+            }
+            if (width <= 0 || height <= 0) return false;
+            processor.resize(width, height);
+            return true;
+        }
+        case Operation::Upscale: {
+            const cv::Mat& image = processor.getCurrentImage();
+            const int scale = Upscaler::getModelScale(op.model);
+            qint64 outputBytes = static_cast<qint64>(image.cols) * scale * image.rows * scale * image.elemSize();
+            if (outputBytes <= MAPPED_UPSCALE_BYTES) {
+                cv::Mat result;
+                {
+                    std::lock_guard<std::mutex> lock(m_upscaleMutex);
+                    m_upscaler->setAlphaMode(op.alphaMode);
+                    result = m_upscaler->upscale(image, op.model, scale);
+                }
+                if (result.empty()) return false;
+                processor.replaceImage(result);
+                return true;
+            }
+            
+            // Several workers' results this size won't fit in RAM - let the OS page
+            // finished bands out to a temporary file. No bicubic fallback here.
+            auto result = std::make_unique<MappedResult>();
+            if (!result->file.open()) {
+                qWarning() << "Cannot create upscale temporary file:" << result->file.errorString();
+                return false;
+            }
+            result->sink = std::make_unique<MappedFileUpscaleSink>(result->file.fileName());
+            {
+                std::lock_guard<std::mutex> lock(m_upscaleMutex);
+                m_upscaler->setAlphaMode(op.alphaMode);
+                if (!m_upscaler->upscaleToSink(image, op.model, scale, *result->sink)) return false;
+            }
+            processor.replaceImage(result->sink->image());
+            mapped.push_back(std::move(result));
+            return true;
+        }
+        case Operation::Export: {
+            QDir dir(QDir(outputDir).filePath(file.relativeDir));
+            if (!dir.exists() && !dir.mkpath(".")) return false;
+            QString name = QFileInfo(file.path).completeBaseName() + op.suffix + "." + op.format;
+            ExportOptions options;
+            options.pngPreset = op.compression;
+            options.quality = op.quality;
+            if (!op.sizes.empty()) {
+                return processor.exportSizes(dir.filePath(name), op.sizes, 0, options);
+            }
+            return processor.exportImage(dir.filePath(name), 0, options);
+        }
+    }
+    return false;
+}
+
+void BatchProcessor::recordStage(int stage, double seconds, double megapixels) {
+    std::lock_guard<std::mutex> lock(m_statsMutex);
+    StageStats& stats = m_stats[stage];
+    stats.images++;
+    stats.seconds += seconds;
+    stats.megapixels += megapixels;
+}
+
+QVector<BatchProcessor::StageStats> BatchProcessor::stageStats() const {
+    std::lock_guard<std::mutex> lock(m_statsMutex);
+    return m_stats;
+}
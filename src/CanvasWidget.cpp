@@ -2,6 +2,7 @@
 #include "ImageProcessor.h"
 #include "ToolManager.h"
 #include "HistoryManager.h"
+#include "InteractionLog.h"
 
 #include <QPainter>
 #include <QMouseEvent>
@@ -11,6 +12,7 @@
 
 CanvasWidget::CanvasWidget(QWidget* parent)
     : QWidget(parent)
+    , m_recorder(std::make_unique<InteractionRecorder>())
 {
     setMouseTracking(true);
     setFocusPolicy(Qt::StrongFocus);
@@ -31,13 +33,53 @@ void CanvasWidget::setToolManager(ToolManager* toolManager) {
 
 void CanvasWidget::setHistoryManager(HistoryManager* historyManager) {
     m_historyManager = historyManager;
+
+    // Undo/redo are triggered from the main window, so record them from history
+    connect(historyManager, &HistoryManager::undoPerformed, this, [this]() { m_recorder->undo(); });
+    connect(historyManager, &HistoryManager::redoPerformed, this, [this]() { m_recorder->redo(); });
+}
+
+bool CanvasWidget::startRecording(const QString& logPath, const QString& imagePath) {
+    if (!m_processor || !m_processor->hasImage()) return false;
+    return m_recorder->start(logPath, imagePath, m_processor->getWidth(), m_processor->getHeight());
+}
+
+void CanvasWidget::stopRecording() {
+    m_recorder->stop();
+}
+
+bool CanvasWidget::isRecording() const {
+    return m_recorder->isRecording();
 }
 
 void CanvasWidget::loadImage(const QString& path) {
     Q_UNUSED(path);
+    m_loadingPreview = QImage();
+    m_loadingSize = QSize();
     rebuildFullCache();
 }
 
+void CanvasWidget::showLoadingPreview(const QImage& preview, const QSize& imageSize) {
+    m_loadingPreview = preview;
+    m_loadingSize = imageSize;
+    fitToScreen();
+}
+
+void CanvasWidget::clearLoadingPreview() {
+    m_loadingPreview = QImage();
+    m_loadingSize = QSize();
+    update();
+}
+
+QSize CanvasWidget::imageSize() const {
+    // A preview of the image being opened stands in for the current one
+    if (!m_loadingPreview.isNull()) return m_loadingSize;
+    if (m_processor && m_processor->hasImage()) {
+        return QSize(m_processor->getWidth(), m_processor->getHeight());
+    }
+    return QSize();
+}
+
 void CanvasWidget::updateDisplay() {
     rebuildFullCache();
     
@@ -47,13 +89,32 @@ void CanvasWidget::updateDisplay() {
     }
 }
 
+void CanvasWidget::updateRegions(const QVector<QRect>& imageRects) {
+    if (!m_processor || !m_processor->hasImage() || m_displayImage.isNull() ||
+        m_displayImage.width() != m_processor->getWidth() ||
+        m_displayImage.height() != m_processor->getHeight()) {
+        updateDisplay();
+        return;
+    }
+    
+    // Re-swizzle only the changed tiles
+    for (const QRect& rect : imageRects) {
+        updateRegion(rect);
+    }
+    
+    // Softened preview is derived from the whole alpha plane
+    if (m_edgeSoftening > 0) {
+        setEdgeSoftening(m_edgeSoftening);
+    }
+}
+
 void CanvasWidget::rebuildFullCache() {
     if (m_processor && m_processor->hasImage()) {
         int w = m_processor->getWidth();
         int h = m_processor->getHeight();
         
-        // Create display image buffer
-        m_displayImage = QImage(w, h, QImage::Format_RGBA8888);
+        // Premultiplied, so drawImage blends it as is instead of converting every frame
+        m_displayImage = QImage(w, h, QImage::Format_ARGB32_Premultiplied);
         m_displayImage.fill(Qt::transparent);
         
         // Reset rendered region tracking
@@ -82,15 +143,12 @@ void CanvasWidget::rebuildFullCache() {
             m_originalImage.height(),
             Qt::KeepAspectRatio,
             Qt::SmoothTransformation
-        );
+        ).convertToFormat(QImage::Format_ARGB32_Premultiplied);
         
         // Reapply softening if active
         if (m_edgeSoftening > 0) {
             cv::Mat result = m_processor->applySoftening(m_processor->getCurrentImage(), m_edgeSoftening);
-            cv::Mat rgba;
-            cv::cvtColor(result, rgba, cv::COLOR_BGRA2RGBA);
-            m_softenedImage = QImage(rgba.data, rgba.cols, rgba.rows,
-                                     static_cast<int>(rgba.step), QImage::Format_RGBA8888).copy();
+            m_softenedImage = ImageProcessor::toDisplayImage(result);
         } else {
             m_softenedImage = QImage();
         }
@@ -126,10 +184,7 @@ void CanvasWidget::setEdgeSoftening(int level) {
     
     if (level > 0) {
         cv::Mat result = m_processor->applySoftening(m_processor->getCurrentImage(), level);
-        cv::Mat rgba;
-        cv::cvtColor(result, rgba, cv::COLOR_BGRA2RGBA);
-        m_softenedImage = QImage(rgba.data, rgba.cols, rgba.rows,
-                                 static_cast<int>(rgba.step), QImage::Format_RGBA8888).copy();
+        m_softenedImage = ImageProcessor::toDisplayImage(result);
     } else {
         m_softenedImage = QImage();
     }
@@ -148,6 +203,18 @@ void CanvasWidget::updateRegion(const QRect& imageRect) {
     update(screenRect.adjusted(-2, -2, 2, 2));
 }
 
+void CanvasWidget::showPreviewTile(const QRect& imageRect, const QImage& tile) {
+    m_previewTiles.append({imageRect, tile});
+    update(imageRectToScreen(imageRect).adjusted(-2, -2, 2, 2));
+}
+
+void CanvasWidget::clearPreviewTiles() {
+    if (m_previewTiles.isEmpty()) return;
+    m_previewTiles.clear();
+    m_previewTiles.squeeze();
+    update();
+}
+
 QRect CanvasWidget::imageRectToScreen(const QRect& imageRect) const {
     return QRect(
         static_cast<int>(imageRect.left() * m_zoom + m_panOffset.x()),
@@ -166,16 +233,17 @@ void CanvasWidget::zoomOut() {
 }
 
 void CanvasWidget::fitToScreen() {
-    if (!m_processor || !m_processor->hasImage()) return;
+    QSize size = imageSize();
+    if (size.isEmpty()) return;
 
-    double scaleX = static_cast<double>(width()) / m_processor->getWidth();
-    double scaleY = static_cast<double>(height()) / m_processor->getHeight();
+    double scaleX = static_cast<double>(width()) / size.width();
+    double scaleY = static_cast<double>(height()) / size.height();
     double scale = std::min(scaleX, scaleY) * 0.95;
 
     m_zoom = std::clamp(scale, MIN_ZOOM, MAX_ZOOM);
     
-    double imgW = m_processor->getWidth() * m_zoom;
-    double imgH = m_processor->getHeight() * m_zoom;
+    double imgW = size.width() * m_zoom;
+    double imgH = size.height() * m_zoom;
     m_panOffset = QPointF((width() - imgW) / 2, (height() - imgH) / 2);
 
     emit zoomChanged(m_zoom);
@@ -257,7 +325,11 @@ void CanvasWidget::paintEvent(QPaintEvent* event) {
     
     drawCheckerboard(painter, dirtyRect);
 
-    if (!m_displayImage.isNull()) {
+    if (!m_loadingPreview.isNull()) {
+        QRectF targetRect(m_panOffset.x(), m_panOffset.y(),
+                          m_loadingSize.width() * m_zoom, m_loadingSize.height() * m_zoom);
+        painter.drawImage(targetRect, m_loadingPreview);
+    } else if (!m_displayImage.isNull()) {
         // For large images, ensure visible area is rendered even during panning
         // This prevents blank image bug
         if (m_isLargeImage) {
@@ -311,8 +383,6 @@ void CanvasWidget::drawCheckerboard(QPainter& painter, const QRect& clipRect) {
 }
 
 void CanvasWidget::drawImage(QPainter& painter, const QRect& clipRect) {
-    Q_UNUSED(clipRect);
-    
     if (m_displayImage.isNull()) return;
     
     QImage* imgToDraw = &m_displayImage;
@@ -330,6 +400,17 @@ void CanvasWidget::drawImage(QPainter& painter, const QRect& clipRect) {
     // Always draw the processed image first
     painter.drawImage(targetRect, *imgToDraw);
     
+    // Upscale preview tiles carry more pixels than the image - visible when zoomed in
+    for (const PreviewTile& tile : m_previewTiles) {
+        QRectF tileRect(m_panOffset.x() + tile.imageRect.x() * m_zoom,
+                        m_panOffset.y() + tile.imageRect.y() * m_zoom,
+                        tile.imageRect.width() * m_zoom,
+                        tile.imageRect.height() * m_zoom);
+        if (tileRect.intersects(clipRect)) {
+            painter.drawImage(tileRect, tile.image);
+        }
+    }
+    
     // If comparing, draw cached blurred original on top with opacity
     if (m_showOriginal && !m_blurredOriginal.isNull()) {
         painter.setOpacity(m_compareOpacity * 0.7);
@@ -426,6 +507,9 @@ void CanvasWidget::mousePressEvent(QMouseEvent* event) {
                 m_historyManager->saveStateBeforeChange();
                 
                 int brushSize = m_toolManager->brushSize();
+                m_recorder->strokeBegin(m_toolManager->currentTool() == ToolManager::ManualErase
+                                            ? InteractionEvent::Erase : InteractionEvent::Repair,
+                                        imagePos, brushSize, m_toolManager->brushHardness());
                 QRect dirtyRect(imagePos.x() - brushSize, imagePos.y() - brushSize,
                                brushSize * 2, brushSize * 2);
 
@@ -480,6 +564,7 @@ void CanvasWidget::mouseMoveEvent(QMouseEvent* event) {
         int maxY = std::max(m_lastDrawPos.y(), imagePos.y()) + brushSize;
         QRect dirtyRect(minX, minY, maxX - minX, maxY - minY);
 
+        m_recorder->strokeMove(imagePos);
         if (m_toolManager->currentTool() == ToolManager::ManualErase) {
             m_processor->eraseAlongPath(m_lastDrawPos, imagePos, brushSize, 
                 m_toolManager->brushHardness());
@@ -526,6 +611,7 @@ void CanvasWidget::mouseReleaseEvent(QMouseEvent* event) {
 
     if (m_isDrawing) {
         m_isDrawing = false;
+        m_recorder->strokeEnd();
         // Save state AFTER the brush stroke is complete
         m_historyManager->saveState();
         emit imageModified();
@@ -611,6 +697,7 @@ void CanvasWidget::leaveEvent(QEvent* event) {
 void CanvasWidget::handleAutoColorTool(const QPoint& imagePos) {
     if (!m_processor || !m_toolManager) return;
     QRect visibleRect = getVisibleImageRect();
+    m_recorder->autoColor(imagePos, m_toolManager->tolerance(), visibleRect);
     m_processor->autoColorRemove(imagePos.x(), imagePos.y(), 
         m_toolManager->tolerance(), visibleRect);
 }
@@ -1,10 +1,10 @@
 #include "ExportDialog.h"
-#include "ImageProcessor.h"
 
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QGroupBox>
 #include <QFileDialog>
+#include <QFileInfo>
 #include <QLineEdit>
 #include <QMessageBox>
 
@@ -64,6 +64,52 @@ void ExportDialog::setupUI() {
     
     mainLayout->addWidget(softenGroup);
 
+    // Format section
+    QGroupBox* formatGroup = new QGroupBox("Format");
+    QVBoxLayout* formatLayout = new QVBoxLayout(formatGroup);
+
+    m_formatCombo = new QComboBox();
+    for (const QString& format : ImageProcessor::exportFormats()) {
+        m_formatCombo->addItem(ImageProcessor::formatFilter(format), format);
+    }
+    formatLayout->addWidget(m_formatCombo);
+
+    // PNG trades encode speed for size; other formats don't use it
+    m_pngPresetRow = new QWidget();
+    QHBoxLayout* presetLayout = new QHBoxLayout(m_pngPresetRow);
+    presetLayout->setContentsMargins(0, 0, 0, 0);
+    QLabel* presetLabel = new QLabel("Compression");
+    m_pngPresetCombo = new QComboBox();
+    m_pngPresetCombo->addItem("Fast - quickest, largest files", PngWriter::Fast);
+    m_pngPresetCombo->addItem("Balanced", PngWriter::Balanced);
+    m_pngPresetCombo->addItem("Small - slowest, smallest files", PngWriter::Small);
+    m_pngPresetCombo->setCurrentIndex(m_pngPresetCombo->findData(PngWriter::Balanced));
+    presetLayout->addWidget(presetLabel);
+    presetLayout->addWidget(m_pngPresetCombo, 1);
+    formatLayout->addWidget(m_pngPresetRow);
+
+    QHBoxLayout* qualityLayout = new QHBoxLayout();
+    QLabel* qualityLabel = new QLabel("Quality");
+    m_qualitySlider = new QSlider(Qt::Horizontal);
+    m_qualitySlider->setRange(1, 100);
+    m_qualitySlider->setValue(100);
+    m_qualityValueLabel = new QLabel("Lossless");
+    m_qualityValueLabel->setMinimumWidth(60);
+    m_qualityValueLabel->setAlignment(Qt::AlignCenter);
+
+    qualityLayout->addWidget(qualityLabel);
+    qualityLayout->addWidget(m_qualitySlider);
+    qualityLayout->addWidget(m_qualityValueLabel);
+    formatLayout->addLayout(qualityLayout);
+
+    QLabel* formatHint = new QLabel("PNG fits everywhere. QOI is lossless and much faster to write but larger. "
+                                    "WebP and AVIF are smallest; quality 100 keeps them lossless.");
+    formatHint->setStyleSheet("color: #888; font-size: 11px;");
+    formatHint->setWordWrap(true);
+    formatLayout->addWidget(formatHint);
+
+    mainLayout->addWidget(formatGroup);
+
     // File path section
     QGroupBox* pathGroup = new QGroupBox("Save Location");
     QHBoxLayout* pathLayout = new QHBoxLayout(pathGroup);
@@ -91,9 +137,59 @@ void ExportDialog::setupUI() {
 
     // Connections
     connect(m_softeningSlider, &QSlider::valueChanged, this, &ExportDialog::onSofteningChanged);
+    connect(m_formatCombo, &QComboBox::currentIndexChanged, this, &ExportDialog::onFormatChanged);
+    connect(m_qualitySlider, &QSlider::valueChanged, this, [this](int quality) {
+        m_qualityValueLabel->setText(quality == 100 ? QString("Lossless") : QString::number(quality));
+    });
     connect(m_browseBtn, &QPushButton::clicked, this, &ExportDialog::onBrowseClicked);
     connect(m_exportBtn, &QPushButton::clicked, this, &ExportDialog::onExportClicked);
     connect(m_cancelBtn, &QPushButton::clicked, this, &QDialog::reject);
+
+    onFormatChanged();
+}
+
+void ExportDialog::setExportPath(const QString& path) {
+    int index = m_formatCombo->findData(QFileInfo(path).suffix().toLower());
+    if (index >= 0) m_formatCombo->setCurrentIndex(index);
+    m_pathEdit->setText(withFormatSuffix(path));
+}
+
+void ExportDialog::setSofteningLevel(int level) {
+    m_softeningSlider->setValue(level);
+}
+
+void ExportDialog::setPngPreset(PngWriter::Preset preset) {
+    m_pngPresetCombo->setCurrentIndex(m_pngPresetCombo->findData(preset));
+}
+
+QString ExportDialog::selectedFormat() const {
+    return m_formatCombo->currentData().toString();
+}
+
+QString ExportDialog::withFormatSuffix(const QString& path) const {
+    if (path.isEmpty()) return path;
+    QFileInfo info(path);
+    if (info.suffix().compare(selectedFormat(), Qt::CaseInsensitive) == 0) return path;
+    // Swap a known image extension, otherwise append
+    QString base = ImageProcessor::exportFormats().contains(info.suffix().toLower())
+                       ? path.left(path.length() - info.suffix().length() - 1)
+                       : path;
+    return base + "." + selectedFormat();
+}
+
+ExportOptions ExportDialog::getExportOptions() const {
+    ExportOptions options;
+    options.pngPreset = static_cast<PngWriter::Preset>(m_pngPresetCombo->currentData().toInt());
+    if (ImageProcessor::formatHasQuality(selectedFormat())) {
+        options.quality = m_qualitySlider->value();
+    }
+    return options;
+}
+
+void ExportDialog::onFormatChanged() {
+    m_qualitySlider->setEnabled(ImageProcessor::formatHasQuality(selectedFormat()));
+    m_pngPresetRow->setVisible(selectedFormat() == "png");
+    m_pathEdit->setText(withFormatSuffix(m_pathEdit->text()));
 }
 
 void ExportDialog::onSofteningChanged(int level) {
@@ -104,13 +200,11 @@ void ExportDialog::onSofteningChanged(int level) {
 
 void ExportDialog::onBrowseClicked() {
     QString filename = QFileDialog::getSaveFileName(
-        this, "Export Image", QString(), "PNG Image (*.png)"
+        this, "Export Image", QString(), ImageProcessor::formatFilter(selectedFormat())
     );
     
     if (!filename.isEmpty()) {
-        if (!filename.endsWith(".png", Qt::CaseInsensitive)) {
-            filename += ".png";
-        }
+        filename = withFormatSuffix(filename);
         m_pathEdit->setText(filename);
         m_exportPath = filename;
     }
@@ -124,9 +218,7 @@ void ExportDialog::onExportClicked() {
         return;
     }
     
-    if (!m_exportPath.endsWith(".png", Qt::CaseInsensitive)) {
-        m_exportPath += ".png";
-    }
+    m_exportPath = withFormatSuffix(m_exportPath);
     
     accept();
 }
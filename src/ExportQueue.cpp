@@ -0,0 +1,155 @@
+#include "ExportQueue.h"
+#include <QDebug>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QThread>
+#include <algorithm>
+#include <mutex>
+#include <thread>
+
+ExportQueue::ExportQueue(QObject* parent)
+    : QObject(parent)
+{
+    m_pool.setMaxThreadCount(MAX_CONCURRENT_EXPORTS);
+}
+
+ExportQueue::~ExportQueue() {
+    m_pool.waitForDone();
+}
+
+QString ExportQueue::stageName(Stage stage) {
+    switch (stage) {
+        case Softening: return "Softening";
+        case Resizing: return "Resizing";
+        case Encoding: return "Encoding";
+        case Writing: return "Writing";
+    }
+    return "";
+}
+
+int ExportQueue::enqueue(const cv::Mat& image, const Request& request) {
+    int jobId = ++m_lastJobId;
+    m_active++;
+
+    // Header copy only - the refcount makes the next in-place edit detach
+    cv::Mat snapshot = image;
+    m_pool.start([this, jobId, snapshot, request]() {
+        bool success = run(jobId, snapshot, request);
+        m_active--;
+        emit finished(jobId, request.path, success);
+    });
+    return jobId;
+}
+
+bool ExportQueue::run(int jobId, const cv::Mat& image, const Request& request) {
+    if (image.empty()) return false;
+
+    // Softened once at full size - every output size shares it
+    cv::Mat pixels = image;
+    if (request.softenLevel > 0) {
+        emit progress(jobId, Softening, 0);
+        pixels = ImageProcessor::applySoftening(image, request.softenLevel);
+        emit progress(jobId, Softening, 100);
+    }
+
+    std::vector<Output> outputs;
+    if (request.longestSides.empty()) {
+        outputs.push_back({request.path, pixels, {}});
+    } else {
+        emit progress(jobId, Resizing, 0);
+        std::vector<cv::Mat> levels = ImageProcessor::downscaleCascade(pixels, request.longestSides);
+        for (size_t i = 0; i < levels.size(); ++i) {
+            if (levels[i].empty()) {
+                qDebug() << "Export skips size" << request.longestSides[i] << "- not below the image size";
+                continue;
+            }
+            outputs.push_back({ImageProcessor::sizedPath(request.path, request.longestSides[i]), levels[i], {}});
+        }
+        emit progress(jobId, Resizing, 100);
+    }
+    pixels.release();
+    if (outputs.empty()) return false;
+
+    if (!encodeAll(jobId, outputs, request.options)) return false;
+    return writeAll(jobId, outputs);
+}
+
+bool ExportQueue::encodeAll(int jobId, std::vector<Output>& outputs, const ExportOptions& options) {
+    emit progress(jobId, Encoding, 0);
+
+    // Every size encodes at once; the cores are split between them and the other running exports
+    int outputCount = static_cast<int>(outputs.size());
+    int threadsEach = std::max(1, QThread::idealThreadCount() / (std::max(1, m_active.load()) * outputCount));
+
+    std::mutex progressMutex;
+    std::vector<int> percents(outputs.size(), 0);
+    int lastPercent = 0;
+    auto report = [&](size_t index, int percent) {
+        std::lock_guard<std::mutex> lock(progressMutex);
+        percents[index] = percent;
+        int total = 0;
+        for (int value : percents) total += value;
+        if (total / outputCount != lastPercent) {
+            lastPercent = total / outputCount;
+            emit progress(jobId, Encoding, lastPercent);
+        }
+    };
+
+    std::vector<char> succeeded(outputs.size(), 0);
+    auto encodeOne = [&](size_t index) {
+        Output& output = outputs[index];
+        QString suffix = QFileInfo(output.path).suffix().toLower();
+        bool ok;
+        if (suffix == "png") {
+            PngWriter writer(options.pngPreset);
+            writer.setThreadCount(threadsEach);
+            writer.setProgressCallback([&report, index](int percent) { report(index, percent); });
+            ok = writer.encode(output.image, output.encoded);
+        } else {
+            ok = ImageProcessor::encodeImage(output.image, suffix, options, output.encoded);
+        }
+        output.image.release();
+        report(index, 100);
+        succeeded[index] = ok;
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < outputs.size(); ++i) {
+        threads.emplace_back(encodeOne, i);
+    }
+    encodeOne(0);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    return std::all_of(succeeded.begin(), succeeded.end(), [](char ok) { return ok != 0; });
+}
+
+bool ExportQueue::writeAll(int jobId, const std::vector<Output>& outputs) {
+    emit progress(jobId, Writing, 0);
+
+    qint64 total = 0;
+    for (const Output& output : outputs) {
+        total += static_cast<qint64>(output.encoded.size());
+    }
+
+    qint64 written = 0;
+    for (const Output& output : outputs) {
+        // Written beside the target and renamed on commit - a failed export never leaves half a file
+        QSaveFile file(output.path);
+        if (!file.open(QIODevice::WriteOnly)) return false;
+
+        const char* data = reinterpret_cast<const char*>(output.encoded.data());
+        qint64 size = static_cast<qint64>(output.encoded.size());
+        for (qint64 offset = 0; offset < size; offset += WRITE_BLOCK_BYTES) {
+            qint64 block = std::min(WRITE_BLOCK_BYTES, size - offset);
+            if (file.write(data + offset, block) != block) {
+                file.cancelWriting();
+                return false;
+            }
+            written += block;
+            emit progress(jobId, Writing, static_cast<int>(written * 100 / std::max<qint64>(1, total)));
+        }
+        if (!file.commit()) return false;
+    }
+    return true;
+}
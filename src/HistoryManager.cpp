@@ -12,23 +12,37 @@ void HistoryManager::setImageProcessor(ImageProcessor* processor) {
     m_processor = processor;
 }
 
+void HistoryManager::discardRedoStates() {
+    if (m_currentIndex < static_cast<int>(m_history.size()) - 1) {
+        m_history.erase(m_history.begin() + m_currentIndex + 1, m_history.end());
+    }
+}
+
 void HistoryManager::saveState() {
     if (!m_processor || !m_processor->hasImage()) return;
 
     // Remove any redo states when making a new change
-    if (m_currentIndex < static_cast<int>(m_history.size()) - 1) {
-        for (size_t i = m_currentIndex + 1; i < m_history.size(); ++i) {
-            m_history[i].imageState.release();
+    discardRedoStates();
+
+    HistoryState historyState;
+
+    if (m_history.empty() || m_processor->isWholeImageChanged()) {
+        // Image was replaced wholesale - keep a full snapshot
+        historyState.imageState = m_processor->captureState();
+        historyState.memorySize = historyState.imageState.total() * historyState.imageState.elemSize();
+    } else {
+        // Only keep the tiles the edit actually touched
+        historyState.before = m_processor->takeChangedTiles();
+        historyState.after.reserve(historyState.before.size());
+
+        const cv::Mat& current = m_processor->getCurrentImage();
+        for (const auto& tile : historyState.before) {
+            historyState.after.push_back({tile.rect, current(tile.rect).clone()});
+            historyState.memorySize += 2 * tile.pixels.total() * tile.pixels.elemSize();
         }
-        m_history.erase(m_history.begin() + m_currentIndex + 1, m_history.end());
     }
 
-    // Capture current state
-    cv::Mat state = m_processor->captureState();
-
-    HistoryState historyState;
-    historyState.imageState = state;
-    historyState.memorySize = state.total() * state.elemSize();
+    m_processor->resetChangeTracking();
 
     m_history.push_back(std::move(historyState));
     m_currentIndex = static_cast<int>(m_history.size()) - 1;
@@ -41,34 +55,34 @@ void HistoryManager::saveStateBeforeChange() {
     // Only save if we don't already have the current state saved
     // This is called BEFORE making a change
     if (!m_processor || !m_processor->hasImage()) return;
-    
+
     // If we're not at the end of history, we already have states ahead - clear them
-    if (m_currentIndex < static_cast<int>(m_history.size()) - 1) {
-        for (size_t i = m_currentIndex + 1; i < m_history.size(); ++i) {
-            m_history[i].imageState.release();
-        }
-        m_history.erase(m_history.begin() + m_currentIndex + 1, m_history.end());
-    }
-    
+    discardRedoStates();
+
+    // Start tracking touched tiles from the current (already saved) state
+    m_processor->resetChangeTracking();
+
     emit historyChanged();
 }
 
 void HistoryManager::saveInitialState() {
     if (!m_processor || !m_processor->hasImage()) return;
-    
+
     // Clear existing history and save initial state
     m_history.clear();
     m_currentIndex = -1;
-    
+
     cv::Mat state = m_processor->captureState();
-    
+
     HistoryState historyState;
     historyState.imageState = state;
     historyState.memorySize = state.total() * state.elemSize();
-    
+
     m_history.push_back(std::move(historyState));
     m_currentIndex = 0;
-    
+
+    m_processor->resetChangeTracking();
+
     emit historyChanged();
 }
 
@@ -80,32 +94,66 @@ bool HistoryManager::canRedo() const {
     return m_currentIndex < static_cast<int>(m_history.size()) - 1;
 }
 
-void HistoryManager::undo() {
-    if (!canUndo() || !m_processor) return;
+QVector<QRect> HistoryManager::undo() {
+    if (!canUndo() || !m_processor) return {};
 
+    const HistoryState& undone = m_history[m_currentIndex];
     m_currentIndex--;
-    m_processor->restoreState(m_history[m_currentIndex].imageState);
+
+    QVector<QRect> changed;
+    if (undone.isSnapshot()) {
+        changed = restoreIndex(m_currentIndex);
+    } else {
+        changed = m_processor->restoreTiles(undone.before);
+    }
+    m_processor->resetChangeTracking();
 
     emit undoPerformed();
     emit historyChanged();
+    return changed;
 }
 
-void HistoryManager::redo() {
-    if (!canRedo() || !m_processor) return;
+QVector<QRect> HistoryManager::redo() {
+    if (!canRedo() || !m_processor) return {};
 
     m_currentIndex++;
-    m_processor->restoreState(m_history[m_currentIndex].imageState);
+    const HistoryState& redone = m_history[m_currentIndex];
+
+    QVector<QRect> changed;
+    if (redone.isSnapshot()) {
+        m_processor->restoreState(redone.imageState);
+        changed = fullImageRegion();
+    } else {
+        changed = m_processor->restoreTiles(redone.after);
+    }
+    m_processor->resetChangeTracking();
 
     emit redoPerformed();
     emit historyChanged();
+    return changed;
+}
+
+QVector<QRect> HistoryManager::restoreIndex(int index) {
+    // Rebuild from the nearest snapshot at or before index, then replay deltas
+    int base = index;
+    while (base > 0 && !m_history[base].isSnapshot()) {
+        base--;
+    }
+
+    m_processor->restoreState(m_history[base].imageState);
+    for (int i = base + 1; i <= index; ++i) {
+        m_processor->restoreTiles(m_history[i].after);
+    }
+    return fullImageRegion();
+}
+
+QVector<QRect> HistoryManager::fullImageRegion() const {
+    if (!m_processor || !m_processor->hasImage()) return {};
+    return {QRect(0, 0, m_processor->getWidth(), m_processor->getHeight())};
 }
 
 void HistoryManager::clear() {
     // Clear all history states and free memory
-    for (auto& state : m_history) {
-        state.imageState.release();
-        state.imageState = cv::Mat();
-    }
     m_history.clear();
     m_history.shrink_to_fit(); // Actually free the vector memory
     m_currentIndex = -1;
@@ -120,18 +168,37 @@ size_t HistoryManager::memoryUsage() const {
     return total;
 }
 
+void HistoryManager::dropOldestState() {
+    // The front entry must stay a snapshot - fold the next delta into it
+    if (m_history.size() > 1 && !m_history[1].isSnapshot()) {
+        HistoryState& base = m_history[0];
+        HistoryState& next = m_history[1];
+        if (base.imageState.u && base.imageState.u->refcount > 1) {
+            base.imageState = base.imageState.clone();  // Still shared with the processor's original
+        }
+        for (const auto& tile : next.after) {
+            tile.pixels.copyTo(base.imageState(tile.rect));
+        }
+        next.imageState = base.imageState;
+        next.memorySize = base.memorySize;
+        next.before.clear();
+        next.after.clear();
+    }
+
+    m_history.erase(m_history.begin());
+    m_currentIndex--;
+}
+
 void HistoryManager::trimHistory() {
     // Limit by count
     while (m_history.size() > MAX_HISTORY) {
-        m_history.erase(m_history.begin());
-        m_currentIndex--;
+        dropOldestState();
     }
 
     // Limit by memory - but ALWAYS keep at least 3 states (initial + 2 undos)
     size_t maxBytes = MAX_MEMORY_MB * 1024 * 1024;
     while (memoryUsage() > maxBytes && m_history.size() > 3) {
-        m_history.erase(m_history.begin());
-        m_currentIndex--;
+        dropOldestState();
     }
 
     m_currentIndex = std::max(0, m_currentIndex);
@@ -1,56 +1,297 @@
 #include "ImageProcessor.h"
+#include "QoiCodec.h"
+#include <QDir>
 #include <QFile>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QSaveFile>
+#include <climits>
 #include <cmath>
 #include <algorithm>
+#include <atomic>
 #include <stack>
 #include <thread>
 
 ImageProcessor::ImageProcessor() = default;
 ImageProcessor::~ImageProcessor() = default;
 
-bool ImageProcessor::loadImage(const QString& path) {
-    std::string stdPath = path.toStdString();
-    m_originalImage = cv::imread(stdPath, cv::IMREAD_UNCHANGED);
+cv::Mat ImageProcessor::decodeFile(const QString& path, int flags) {
+    // Decode from a read-only mapping - file pages stay out of the private working set
+    // and non-ASCII paths work on Windows
+    QFile file(path);
+    if (file.open(QIODevice::ReadOnly) && file.size() > 0 && file.size() <= INT_MAX) {
+        uchar* mapped = file.map(0, file.size());
+        if (mapped) {
+            cv::Mat image;
+            if (QoiCodec::isQoi(mapped, static_cast<size_t>(file.size()))) {
+                image = QoiCodec::decode(mapped, static_cast<size_t>(file.size()));
+            } else {
+                cv::Mat encoded(1, static_cast<int>(file.size()), CV_8UC1, mapped);
+                image = cv::imdecode(encoded, flags);
+            }
+            file.unmap(mapped);
+            if (!image.empty()) return image;
+        }
+    }
+    return cv::imread(path.toStdString(), flags);
+}
+
+cv::Mat ImageProcessor::decodeImage(const QString& path) {
+    cv::Mat image = decodeFile(path);
+    if (!image.empty()) {
+        ensureAlphaChannel(image);
+    }
+    return image;
+}
+
+QImage ImageProcessor::decodePreview(const QString& path, int maxSide, QSize* fullSize) {
+    // Header only - no pixels are decoded here
+    QImageReader reader(path);
+    QSize size = reader.size();
+    if (fullSize) *fullSize = size;
+    if (!size.isValid()) return QImage();
+
+    // libjpeg scales during the DCT, so a reduced JPEG decode costs a fraction of the full one.
+    // Other formats would decode everything and then shrink - no faster than the full load.
+    QByteArray format = reader.format();
+    if (format != "jpeg" && format != "jpg") return QImage();
+
+    int longest = std::max(size.width(), size.height());
+    if (longest <= maxSide) return QImage();  // Full decode is already quick
+
+    int flags = cv::IMREAD_REDUCED_COLOR_8;
+    if (longest / 2 <= maxSide) {
+        flags = cv::IMREAD_REDUCED_COLOR_2;
+    } else if (longest / 4 <= maxSide) {
+        flags = cv::IMREAD_REDUCED_COLOR_4;
+    }
 
-    if (m_originalImage.empty()) {
+    cv::Mat reduced = decodeFile(path, flags);
+    if (reduced.empty() || reduced.channels() != 3) return QImage();
+
+    cv::Mat rgb;
+    cv::cvtColor(reduced, rgb, cv::COLOR_BGR2RGB);
+    return QImage(rgb.data, rgb.cols, rgb.rows,
+                  static_cast<int>(rgb.step), QImage::Format_RGB888).copy();
+}
+
+bool ImageProcessor::loadImage(const QString& path) {
+    cv::Mat image = decodeFile(path);
+    if (image.empty()) {
         return false;
     }
 
-    ensureAlphaChannel(m_originalImage);
-    m_currentImage = m_originalImage.clone();
-    
-    // Pre-convert to LAB for smart color matching
-    cv::Mat bgr;
-    cv::cvtColor(m_currentImage, bgr, cv::COLOR_BGRA2BGR);
-    cv::cvtColor(bgr, m_labImage, cv::COLOR_BGR2Lab);
+    // Drop the previous image before expanding, so only the decode and the final buffer coexist
+    clear();
+    ensureAlphaChannel(image);
 
+    // Current shares the original until the first edit; LAB is built on first auto-color
+    m_originalImage = image;
+    m_currentImage = image;
+    m_imageReplaced = true;
     return true;
 }
 
-void ImageProcessor::updateLabCache() {
-    if (m_currentImage.empty()) return;
+void ImageProcessor::replaceImage(const cv::Mat& image) {
+    m_originalImage = image;
+    m_currentImage = image;
+    m_labImage.release();
+    m_imageReplaced = true;
+}
+
+void ImageProcessor::detachCurrent() {
+    // Shared with the original, a history snapshot or a running export - copy before writing
+    if (!m_currentImage.empty() && m_currentImage.u && m_currentImage.u->refcount > 1) {
+        m_currentImage = m_currentImage.clone();
+    }
+}
+
+void ImageProcessor::ensureLabCache() {
+    if (m_currentImage.empty() || m_labImage.size() == m_currentImage.size()) return;
     cv::Mat bgr;
     cv::cvtColor(m_currentImage, bgr, cv::COLOR_BGRA2BGR);
     cv::cvtColor(bgr, m_labImage, cv::COLOR_BGR2Lab);
 }
 
+void ImageProcessor::updateLabRegion(const cv::Rect& rect) {
+    if (m_labImage.size() != m_currentImage.size()) {
+        m_labImage.release();  // Rebuilt in full when next needed
+        return;
+    }
+    // Destination is a ROI of matching size/type, so cvtColor writes in place
+    cv::Mat bgr;
+    cv::cvtColor(m_currentImage(rect), bgr, cv::COLOR_BGRA2BGR);
+    cv::Mat labRoi = m_labImage(rect);
+    cv::cvtColor(bgr, labRoi, cv::COLOR_BGR2Lab);
+}
+
+namespace {
+
+constexpr double LANCZOS_LOBES = 3.0;
+constexpr int RESIZE_BAND_ROWS = 64;  // Output rows per task - the horizontal pass is band-local
+
+double lanczos(double x) {
+    x = std::abs(x);
+    if (x < 1e-8) return 1.0;
+    if (x >= LANCZOS_LOBES) return 0.0;
+    double px = CV_PI * x;
+    return LANCZOS_LOBES * std::sin(px) * std::sin(px / LANCZOS_LOBES) / (px * px);
+}
+
+// Lanczos-3 coefficients for one axis, computed once per resize. Shrinking stretches the kernel
+// over every source pixel an output pixel covers, where INTER_LANCZOS4 keeps 8 taps and aliases.
+struct FilterTaps {
+    int taps = 0;                   // Per output pixel, zero-padded
+    std::vector<int> start;         // First source index per output pixel
+    std::vector<float> weights;     // taps per output pixel, normalised to 1
+};
+
+FilterTaps lanczosTaps(int srcSize, int dstSize) {
+    double scale = static_cast<double>(dstSize) / srcSize;
+    double stretch = std::min(1.0, scale);
+    double support = LANCZOS_LOBES / stretch;
+
+    FilterTaps filter;
+    filter.taps = std::min(srcSize, static_cast<int>(std::ceil(support)) * 2 + 1);
+    filter.start.resize(dstSize);
+    filter.weights.resize(static_cast<size_t>(dstSize) * filter.taps);
+
+    for (int i = 0; i < dstSize; ++i) {
+        double center = (i + 0.5) / scale;
+        // Window slides inside the image at the borders; taps past the support weigh zero
+        int first = std::clamp(static_cast<int>(std::floor(center - support)), 0, srcSize - filter.taps);
+        float* weights = &filter.weights[static_cast<size_t>(i) * filter.taps];
+        double sum = 0.0;
+        for (int k = 0; k < filter.taps; ++k) {
+            double weight = lanczos((first + k + 0.5 - center) * stretch);
+            weights[k] = static_cast<float>(weight);
+            sum += weight;
+        }
+        if (sum != 0.0) {
+            for (int k = 0; k < filter.taps; ++k) weights[k] = static_cast<float>(weights[k] / sum);
+        }
+        filter.start[i] = first;
+    }
+    return filter;
+}
+
+// Output rows [y0, y1): horizontal pass over only the source rows they need, then vertical
+template <int CN>
+void resampleBand(const cv::Mat& src, cv::Mat& dst, const FilterTaps& horizontal, const FilterTaps& vertical,
+                  int y0, int y1) {
+    int srcY0 = vertical.start[y0];
+    int srcY1 = vertical.start[y1 - 1] + vertical.taps;
+    int rowFloats = dst.cols * CN;
+    std::vector<float> rows(static_cast<size_t>(srcY1 - srcY0) * rowFloats);
+    std::vector<float> accum(rowFloats);
+
+    for (int sy = srcY0; sy < srcY1; ++sy) {
+        const uchar* in = src.ptr<uchar>(sy);
+        float* out = &rows[static_cast<size_t>(sy - srcY0) * rowFloats];
+        for (int x = 0; x < dst.cols; ++x) {
+            const float* weights = &horizontal.weights[static_cast<size_t>(x) * horizontal.taps];
+            const uchar* px = in + horizontal.start[x] * CN;
+            float sum[CN] = {};
+            for (int k = 0; k < horizontal.taps; ++k, px += CN) {
+                for (int c = 0; c < CN; ++c) sum[c] += weights[k] * px[c];
+            }
+            for (int c = 0; c < CN; ++c) out[x * CN + c] = sum[c];
+        }
+    }
+
+    for (int y = y0; y < y1; ++y) {
+        const float* weights = &vertical.weights[static_cast<size_t>(y) * vertical.taps];
+        const float* row = &rows[static_cast<size_t>(vertical.start[y] - srcY0) * rowFloats];
+        std::fill(accum.begin(), accum.end(), 0.0f);
+        for (int k = 0; k < vertical.taps; ++k, row += rowFloats) {
+            float weight = weights[k];
+            for (int i = 0; i < rowFloats; ++i) accum[i] += weight * row[i];
+        }
+        uchar* out = dst.ptr<uchar>(y);
+        for (int i = 0; i < rowFloats; ++i) out[i] = cv::saturate_cast<uchar>(accum[i]);
+    }
+}
+
+// Resamples every image to size at once. Shrinking splits all outputs into bands in one
+// parallel loop and drops each source the moment its last band lands; pure enlargements
+// keep INTER_LANCZOS4, one image per thread.
+std::vector<cv::Mat> resizeLanczos(std::vector<cv::Mat>& sources, cv::Size size) {
+    std::vector<cv::Mat> results(sources.size());
+    if (sources.empty()) return results;
+
+    cv::Size from = sources[0].size();
+    bool supported = true;
+    for (const cv::Mat& source : sources) {
+        int cn = source.channels();
+        supported = supported && source.size() == from && source.depth() == CV_8U && (cn == 1 || cn == 3 || cn == 4);
+    }
+
+    if (!supported || (size.width >= from.width && size.height >= from.height)) {
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < sources.size(); ++i) {
+            threads.emplace_back([&, i]() {
+                cv::resize(sources[i], results[i], size, 0, 0, cv::INTER_LANCZOS4);
+                sources[i].release();
+            });
+        }
+        cv::resize(sources[0], results[0], size, 0, 0, cv::INTER_LANCZOS4);
+        sources[0].release();
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        return results;
+    }
+
+    FilterTaps horizontal = lanczosTaps(from.width, size.width);
+    FilterTaps vertical = lanczosTaps(from.height, size.height);
+    int bandsEach = (size.height + RESIZE_BAND_ROWS - 1) / RESIZE_BAND_ROWS;
+    std::vector<std::atomic<int>> bandsLeft(sources.size());
+    for (size_t i = 0; i < sources.size(); ++i) {
+        results[i].create(size, sources[i].type());
+        bandsLeft[i] = bandsEach;
+    }
+
+    // Bands are numbered image by image, so the first source finishes - and frees - early
+    cv::parallel_for_(cv::Range(0, bandsEach * static_cast<int>(sources.size())), [&](const cv::Range& range) {
+        for (int band = range.start; band < range.end; ++band) {
+            size_t image = static_cast<size_t>(band / bandsEach);
+            int y0 = (band % bandsEach) * RESIZE_BAND_ROWS;
+            int y1 = std::min(size.height, y0 + RESIZE_BAND_ROWS);
+            switch (sources[image].channels()) {
+                case 1: resampleBand<1>(sources[image], results[image], horizontal, vertical, y0, y1); break;
+                case 3: resampleBand<3>(sources[image], results[image], horizontal, vertical, y0, y1); break;
+                default: resampleBand<4>(sources[image], results[image], horizontal, vertical, y0, y1); break;
+            }
+            if (--bandsLeft[image] == 0) {
+                sources[image].release();
+            }
+        }
+    });
+    return results;
+}
+
+} // namespace
+
 void ImageProcessor::resize(int newWidth, int newHeight) {
     if (m_currentImage.empty()) return;
     
-    cv::Mat resized;
-    cv::resize(m_currentImage, resized, cv::Size(newWidth, newHeight), 0, 0, cv::INTER_LANCZOS4);
-    m_currentImage = resized;
-    
-    cv::resize(m_originalImage, resized, cv::Size(newWidth, newHeight), 0, 0, cv::INTER_LANCZOS4);
-    m_originalImage = resized;
-    
-    updateLabCache();
-}
+    // The engine's references move into the resampler, so each old buffer is freed as soon
+    // as its image is done rather than after both. The LAB cache goes before anything grows.
+    m_labImage.release();
+    bool shared = m_currentImage.data == m_originalImage.data;
+    std::vector<cv::Mat> sources;
+    sources.push_back(std::move(m_currentImage));
+    if (shared) {
+        m_originalImage.release();  // Unedited - one resample serves both
+    } else {
+        sources.push_back(std::move(m_originalImage));
+    }
 
-void ImageProcessor::updateOriginalImage() {
-    if (m_currentImage.empty()) return;
-    m_originalImage = m_currentImage.clone();
-    updateLabCache();  // Sync LAB cache for Auto Color Remove tool
+    std::vector<cv::Mat> results = resizeLanczos(sources, cv::Size(newWidth, newHeight));
+    m_currentImage = results[0];
+    m_originalImage = shared ? results[0] : results[1];
+    
+    m_imageReplaced = true;
 }
 
 void ImageProcessor::clear() {
@@ -63,25 +304,189 @@ void ImageProcessor::clear() {
     m_currentImage = cv::Mat();
     m_originalImage = cv::Mat();
     m_labImage = cv::Mat();
+    
+    m_touchedTiles.clear();
+    m_tileBackups.clear();
+    m_imageReplaced = true;
+}
+
+namespace {
+
+// BGRA8 to 16-bit premultiplied - colour holds c * a, alpha is scaled to the full 16-bit range,
+// so downsampling never averages in the colour of transparent pixels
+cv::Mat premultiply16(const cv::Mat& image) {
+    cv::Mat result(image.size(), CV_16UC4);
+    cv::parallel_for_(cv::Range(0, image.rows), [&](const cv::Range& range) {
+        for (int y = range.start; y < range.end; ++y) {
+            const cv::Vec4b* src = image.ptr<cv::Vec4b>(y);
+            cv::Vec4w* dst = result.ptr<cv::Vec4w>(y);
+            for (int x = 0; x < image.cols; ++x) {
+                int alpha = src[x][3];
+                dst[x] = cv::Vec4w(static_cast<ushort>(src[x][0] * alpha), static_cast<ushort>(src[x][1] * alpha),
+                                   static_cast<ushort>(src[x][2] * alpha), static_cast<ushort>(alpha * 257));
+            }
+        }
+    });
+    return result;
+}
+
+cv::Mat unpremultiply16(const cv::Mat& image) {
+    cv::Mat result(image.size(), CV_8UC4);
+    cv::parallel_for_(cv::Range(0, image.rows), [&](const cv::Range& range) {
+        for (int y = range.start; y < range.end; ++y) {
+            const cv::Vec4w* src = image.ptr<cv::Vec4w>(y);
+            cv::Vec4b* dst = result.ptr<cv::Vec4b>(y);
+            for (int x = 0; x < image.cols; ++x) {
+                int alpha = src[x][3];
+                if (alpha == 0) {
+                    dst[x] = cv::Vec4b(0, 0, 0, 0);
+                    continue;
+                }
+                // c = (c * a) / a, with a back on the 0-255 scale
+                for (int c = 0; c < 3; ++c) {
+                    dst[x][c] = cv::saturate_cast<uchar>((src[x][c] * 257.0f) / alpha);
+                }
+                dst[x][3] = static_cast<uchar>((alpha + 128) / 257);
+            }
+        }
+    });
+    return result;
+}
+
+} // namespace
+
+std::vector<cv::Mat> ImageProcessor::downscaleCascade(const cv::Mat& image,
+                                                      const std::vector<int>& longestSides) {
+    std::vector<cv::Mat> levels(longestSides.size());
+    if (image.empty()) return levels;
+
+    // Largest first, so each level resamples the nearest larger one rather than the full image
+    std::vector<size_t> order(longestSides.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return longestSides[a] > longestSides[b]; });
+
+    bool premultiplied = image.type() == CV_8UC4;
+    cv::Mat source = premultiplied ? premultiply16(image) : image;
+    int sourceLongest = std::max(image.cols, image.rows);
+
+    for (size_t index : order) {
+        int side = longestSides[index];
+        if (side <= 0 || side >= sourceLongest) continue;
+
+        double scale = static_cast<double>(side) / std::max(image.cols, image.rows);
+        cv::Size size(std::max(1, cvRound(image.cols * scale)), std::max(1, cvRound(image.rows * scale)));
+
+        // Area averaging is the anti-aliased filter for shrinking; Lanczos aliases past 2:1
+        cv::Mat level;
+        cv::resize(source, level, size, 0, 0, cv::INTER_AREA);
+        levels[index] = premultiplied ? unpremultiply16(level) : level;
+
+        source = level;
+        sourceLongest = side;
+    }
+    return levels;
+}
+
+// PNG goes through the multi-threaded writer; other formats keep OpenCV's encoders
+bool ImageProcessor::writeImage(const QString& path, const cv::Mat& image, const ExportOptions& options) {
+    QString format = QFileInfo(path).suffix().toLower();
+    if (format == "png") {
+        return PngWriter(options.pngPreset).write(path, image);  // Streams each stripe to the file
+    }
+
+    std::vector<uchar> encoded;
+    if (!encodeImage(image, format, options, encoded)) return false;
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+    qint64 size = static_cast<qint64>(encoded.size());
+    if (file.write(reinterpret_cast<const char*>(encoded.data()), size) != size) {
+        file.cancelWriting();
+        return false;
+    }
+    return file.commit();
+}
+
+bool ImageProcessor::encodeImage(const cv::Mat& image, const QString& format, const ExportOptions& options,
+                                 std::vector<uchar>& out) {
+    QString ext = format.toLower();
+    if (ext == "png") return PngWriter(options.pngPreset).encode(image, out);
+    if (ext == "qoi") return QoiCodec::encode(image, out);
+
+    int quality = std::clamp(options.quality, 1, 100);
+    std::vector<int> params;
+    if (ext == "webp") {
+        params = {cv::IMWRITE_WEBP_QUALITY, quality == 100 ? 101 : quality};  // Above 100 is lossless
+    }
+#if CV_VERSION_MAJOR > 4 || (CV_VERSION_MAJOR == 4 && CV_VERSION_MINOR >= 10)
+    if (ext == "avif") {
+        params = {cv::IMWRITE_AVIF_QUALITY, quality};                       // 100 is lossless
+    }
+#endif
+
+    try {
+        return cv::imencode("." + ext.toStdString(), image, out, params);
+    } catch (const cv::Exception&) {
+        return false;  // No encoder for this extension in the OpenCV build
+    }
+}
+
+QStringList ImageProcessor::exportFormats() {
+    QStringList formats = {"png", "qoi"};
+    if (cv::haveImageWriter("export.webp")) formats << "webp";
+#if CV_VERSION_MAJOR > 4 || (CV_VERSION_MAJOR == 4 && CV_VERSION_MINOR >= 10)
+    // Older OpenCV has no quality parameter, so no lossless AVIF
+    if (cv::haveImageWriter("export.avif")) formats << "avif";
+#endif
+    return formats;
+}
+
+QString ImageProcessor::formatFilter(const QString& format) {
+    QString ext = format.toLower();
+    QString name = ext == "webp" ? "WebP" : ext.toUpper();
+    return QString("%1 Image (*.%2)").arg(name, ext);
+}
+
+bool ImageProcessor::formatHasQuality(const QString& format) {
+    QString ext = format.toLower();
+    return ext == "webp" || ext == "avif";
+}
+
+QString ImageProcessor::sizedPath(const QString& path, int longestSide) {
+    QFileInfo info(path);
+    return info.dir().filePath(QString("%1_%2.%3").arg(info.completeBaseName()).arg(longestSide).arg(info.suffix()));
 }
 
 bool ImageProcessor::saveImage(const QString& path) {
     if (m_currentImage.empty()) return false;
-    std::vector<int> params = {cv::IMWRITE_PNG_COMPRESSION, 6};
-    return cv::imwrite(path.toStdString(), m_currentImage, params);
+    return writeImage(path, m_currentImage);
 }
 
-bool ImageProcessor::exportImage(const QString& path, int edgeSoftenLevel) {
+bool ImageProcessor::exportImage(const QString& path, int edgeSoftenLevel, const ExportOptions& options) {
     if (m_currentImage.empty()) return false;
 
-    cv::Mat exportImage = m_currentImage.clone();
-    
-    if (edgeSoftenLevel > 0) {
-        exportImage = applySoftening(exportImage, edgeSoftenLevel);
-    }
+    // Softening works on its own copy; otherwise the encoder only reads
+    cv::Mat exportImage = edgeSoftenLevel > 0 ? applySoftening(m_currentImage, edgeSoftenLevel)
+                                              : m_currentImage;
+
+    return writeImage(path, exportImage, options);
+}
+
+bool ImageProcessor::exportSizes(const QString& path, const std::vector<int>& longestSides,
+                                 int edgeSoftenLevel, const ExportOptions& options) {
+    if (m_currentImage.empty()) return false;
+
+    // Soften once at full size; every level inherits it
+    cv::Mat source = edgeSoftenLevel > 0 ? applySoftening(m_currentImage, edgeSoftenLevel) : m_currentImage;
+    std::vector<cv::Mat> levels = downscaleCascade(source, longestSides);
 
-    std::vector<int> params = {cv::IMWRITE_PNG_COMPRESSION, 6};
-    return cv::imwrite(path.toStdString(), exportImage, params);
+    bool wrote = false;
+    for (size_t i = 0; i < levels.size(); ++i) {
+        if (levels[i].empty()) continue;
+        if (!writeImage(sizedPath(path, longestSides[i]), levels[i], options)) return false;
+        wrote = true;
+    }
+    return wrote;
 }
 
 QImage ImageProcessor::getDisplayImage() const {
@@ -93,6 +498,40 @@ QImage ImageProcessor::getDisplayImage() const {
                  static_cast<int>(rgba.step), QImage::Format_RGBA8888).copy();
 }
 
+namespace {
+
+// BGRA to premultiplied ARGB32 in the same pass as the swizzle. QPainter blends this format
+// directly; a straight-alpha image is converted on every drawImage.
+inline void premultiplyRow(const cv::Vec4b* src, QRgb* dst, int count) {
+    for (int x = 0; x < count; ++x) {
+        uint alpha = src[x][3];
+        if (alpha == 255) {
+            dst[x] = 0xff000000u | (uint(src[x][2]) << 16) | (uint(src[x][1]) << 8) | src[x][0];
+        } else if (alpha == 0) {
+            dst[x] = 0;
+        } else {
+            // c * a / 255, exactly rounded
+            auto scale = [alpha](uint c) {
+                uint t = c * alpha + 128;
+                return (t + (t >> 8)) >> 8;
+            };
+            dst[x] = (alpha << 24) | (scale(src[x][2]) << 16) | (scale(src[x][1]) << 8) | scale(src[x][0]);
+        }
+    }
+}
+
+} // namespace
+
+QImage ImageProcessor::toDisplayImage(const cv::Mat& image) {
+    if (image.empty() || image.type() != CV_8UC4) return QImage();
+
+    QImage result(image.cols, image.rows, QImage::Format_ARGB32_Premultiplied);
+    for (int y = 0; y < image.rows; ++y) {
+        premultiplyRow(image.ptr<cv::Vec4b>(y), reinterpret_cast<QRgb*>(result.scanLine(y)), image.cols);
+    }
+    return result;
+}
+
 void ImageProcessor::updateDisplayRegion(QImage& target, const QRect& region) const {
     if (m_currentImage.empty() || target.isNull()) return;
     
@@ -104,7 +543,15 @@ void ImageProcessor::updateDisplayRegion(QImage& target, const QRect& region) co
     
     if (x1 >= x2 || y1 >= y2) return;
     
-    // Direct pixel copy with color conversion (BGRA -> RGBA)
+    if (target.format() == QImage::Format_ARGB32_Premultiplied) {
+        for (int y = y1; y < y2; ++y) {
+            premultiplyRow(m_currentImage.ptr<cv::Vec4b>(y) + x1,
+                           reinterpret_cast<QRgb*>(target.scanLine(y)) + x1, x2 - x1);
+        }
+        return;
+    }
+
+    // Straight alpha - direct pixel copy with color conversion (BGRA -> RGBA)
     for (int y = y1; y < y2; ++y) {
         const cv::Vec4b* srcRow = m_currentImage.ptr<cv::Vec4b>(y);
         uchar* dstRow = target.scanLine(y);
@@ -151,12 +598,15 @@ QImage ImageProcessor::matToQImage(const cv::Mat& mat) const {
 
 // Smart color matching using LAB color space - perceptually accurate
 void ImageProcessor::autoColorRemove(int x, int y, int tolerance, const QRect& viewportBounds) {
-    if (m_currentImage.empty() || m_labImage.empty()) return;
+    if (m_currentImage.empty()) return;
     if (x < 0 || x >= m_currentImage.cols || y < 0 || y >= m_currentImage.rows) return;
 
     cv::Vec4b seedBGRA = m_currentImage.at<cv::Vec4b>(y, x);
     if (seedBGRA[3] == 0) return;
     
+    detachCurrent();
+    ensureLabCache();
+    
     cv::Vec3b seedLab = m_labImage.at<cv::Vec3b>(y, x);
 
     int minX = viewportBounds.isValid() ? std::max(0, viewportBounds.left()) : 0;
@@ -200,6 +650,9 @@ void ImageProcessor::autoColorRemove(int x, int y, int tolerance, const QRect& v
         if (deltaESq > maxDeltaESq) continue;
 
         visited.at<uchar>(pt.y, pt.x) = 1;
+        if (!m_imageReplaced && !m_touchedTiles[(pt.y / CHANGE_TILE_SIZE) * m_trackedTilesX + pt.x / CHANGE_TILE_SIZE]) {
+            backupTiles(pt.x, pt.y, pt.x, pt.y);
+        }
         pixel[3] = 0; // Make transparent
 
         // Add neighbors (4-connected)
@@ -208,8 +661,7 @@ void ImageProcessor::autoColorRemove(int x, int y, int tolerance, const QRect& v
         if (pt.y > minY) queue.push_back(cv::Point(pt.x, pt.y - 1));
         if (pt.y < maxY) queue.push_back(cv::Point(pt.x, pt.y + 1));
     }
-    
-    updateLabCache();
+    // Only alpha changed, so the LAB cache is still valid
 }
 
 bool ImageProcessor::colorMatches(const cv::Vec4b& c1, const cv::Vec4b& c2, int tolerance) const {
@@ -238,6 +690,8 @@ void ImageProcessor::eraseWithBrush(int centerX, int centerY, int diameter, floa
     int maxY = std::min(m_currentImage.rows - 1, centerY + radius);
     
     if (minX > maxX || minY > maxY) return;
+    detachCurrent();
+    backupTiles(minX, minY, maxX, maxY);
 
     float radiusSq = static_cast<float>(radius * radius);
     float hardRadius = radius * hardness;
@@ -305,6 +759,9 @@ void ImageProcessor::repairWithBrush(int centerX, int centerY, int diameter) {
     int maxY = std::min(m_currentImage.rows - 1, centerY + radius);
     
     if (minX > maxX || minY > maxY) return;
+    if (m_currentImage.data == m_originalImage.data) return;  // Nothing edited yet - nothing to repair
+    detachCurrent();
+    backupTiles(minX, minY, maxX, maxY);
 
     float radiusSq = static_cast<float>(radius * radius);
     float hardRadius = radius * 0.8f;
@@ -407,10 +864,66 @@ cv::Mat ImageProcessor::applySoftening(const cv::Mat& image, int level) {
 }
 
 cv::Mat ImageProcessor::captureState() const {
+    // The original is never written in place, so an unedited image can be shared
+    if (m_currentImage.data == m_originalImage.data) return m_currentImage;
     return m_currentImage.clone();
 }
 
 void ImageProcessor::restoreState(const cv::Mat& state) {
-    m_currentImage = state.clone();
-    updateLabCache();
+    m_currentImage = state.data == m_originalImage.data ? state : state.clone();
+    m_imageReplaced = true;
+    m_labImage.release();
+}
+
+void ImageProcessor::resetChangeTracking() {
+    m_trackedTilesX = (m_currentImage.cols + CHANGE_TILE_SIZE - 1) / CHANGE_TILE_SIZE;
+    int tilesY = (m_currentImage.rows + CHANGE_TILE_SIZE - 1) / CHANGE_TILE_SIZE;
+    m_touchedTiles.assign(static_cast<size_t>(m_trackedTilesX) * tilesY, 0);
+    m_tileBackups.clear();
+    m_imageReplaced = m_currentImage.empty();
+}
+
+bool ImageProcessor::isWholeImageChanged() const {
+    return m_imageReplaced;
+}
+
+std::vector<ImageProcessor::TilePatch> ImageProcessor::takeChangedTiles() {
+    std::vector<TilePatch> tiles = std::move(m_tileBackups);
+    m_tileBackups.clear();
+    std::fill(m_touchedTiles.begin(), m_touchedTiles.end(), 0);
+    return tiles;
+}
+
+void ImageProcessor::backupTiles(int minX, int minY, int maxX, int maxY) {
+    // Whole-image changes are snapshotted by HistoryManager, no need for tiles
+    if (m_imageReplaced || m_touchedTiles.empty()) return;
+
+    for (int ty = minY / CHANGE_TILE_SIZE; ty <= maxY / CHANGE_TILE_SIZE; ++ty) {
+        for (int tx = minX / CHANGE_TILE_SIZE; tx <= maxX / CHANGE_TILE_SIZE; ++tx) {
+            uchar& touched = m_touchedTiles[ty * m_trackedTilesX + tx];
+            if (touched) continue;
+            touched = 1;
+
+            cv::Rect rect(tx * CHANGE_TILE_SIZE, ty * CHANGE_TILE_SIZE,
+                          std::min(CHANGE_TILE_SIZE, m_currentImage.cols - tx * CHANGE_TILE_SIZE),
+                          std::min(CHANGE_TILE_SIZE, m_currentImage.rows - ty * CHANGE_TILE_SIZE));
+            m_tileBackups.push_back({rect, m_currentImage(rect).clone()});
+        }
+    }
+}
+
+QVector<QRect> ImageProcessor::restoreTiles(const std::vector<TilePatch>& tiles) {
+    QVector<QRect> changed;
+    changed.reserve(static_cast<int>(tiles.size()));
+    
+    if (!tiles.empty()) detachCurrent();
+    
+    cv::Rect bounds(0, 0, m_currentImage.cols, m_currentImage.rows);
+    for (const auto& tile : tiles) {
+        if ((tile.rect & bounds) != tile.rect) continue;
+        tile.pixels.copyTo(m_currentImage(tile.rect));
+        updateLabRegion(tile.rect);
+        changed.append(QRect(tile.rect.x, tile.rect.y, tile.rect.width, tile.rect.height));
+    }
+    return changed;
 }
@@ -0,0 +1,188 @@
+#include "InteractionLog.h"
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+namespace {
+
+constexpr int LOG_VERSION = 1;
+
+const char* toolName(InteractionEvent::Tool tool) {
+    return tool == InteractionEvent::Repair ? "repair" : "erase";
+}
+
+bool parseType(const QString& name, InteractionEvent::Type& type) {
+    for (auto candidate : {InteractionEvent::AutoColor, InteractionEvent::StrokeBegin,
+                           InteractionEvent::StrokeMove, InteractionEvent::StrokeEnd,
+                           InteractionEvent::Undo, InteractionEvent::Redo}) {
+        if (InteractionEvent::typeName(candidate) == name) {
+            type = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+QString InteractionEvent::typeName(Type type) {
+    switch (type) {
+        case AutoColor: return "autoColor";
+        case StrokeBegin: return "strokeBegin";
+        case StrokeMove: return "strokeMove";
+        case StrokeEnd: return "strokeEnd";
+        case Undo: return "undo";
+        case Redo: return "redo";
+    }
+    return "";
+}
+
+bool InteractionLog::load(const QString& path, QString* error) {
+    auto fail = [error](const QString& message) {
+        if (error) *error = message;
+        return false;
+    };
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return fail("Cannot open " + path + ": " + file.errorString());
+    }
+
+    QJsonObject header = QJsonDocument::fromJson(file.readLine()).object();
+    if (header.value("version").toInt() != LOG_VERSION) {
+        return fail("Unsupported interaction log version");
+    }
+    imagePath = header.value("image").toString();
+    width = header.value("width").toInt();
+    height = header.value("height").toInt();
+
+    events.clear();
+    int line = 1;
+    while (!file.atEnd()) {
+        QByteArray text = file.readLine().trimmed();
+        line++;
+        if (text.isEmpty()) continue;
+
+        QJsonObject object = QJsonDocument::fromJson(text).object();
+        InteractionEvent event;
+        if (!parseType(object.value("type").toString(), event.type)) {
+            return fail(QString("Line %1: unknown event").arg(line));
+        }
+        event.timeMs = object.value("t").toInteger();
+        event.pos = QPoint(object.value("x").toInt(), object.value("y").toInt());
+        event.tool = object.value("tool").toString() == "repair" ? InteractionEvent::Repair
+                                                                 : InteractionEvent::Erase;
+        event.brushSize = object.value("size").toInt();
+        event.hardness = static_cast<float>(object.value("hardness").toDouble(0.8));
+        event.tolerance = object.value("tolerance").toInt();
+        QJsonArray viewport = object.value("viewport").toArray();
+        if (viewport.size() == 4) {
+            event.viewport = QRect(viewport[0].toInt(), viewport[1].toInt(),
+                                   viewport[2].toInt(), viewport[3].toInt());
+        }
+        events.append(event);
+    }
+    return true;
+}
+
+bool InteractionRecorder::start(const QString& path, const QString& imagePath, int width, int height) {
+    stop();
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        return false;
+    }
+
+    QJsonObject header;
+    header["version"] = LOG_VERSION;
+    header["image"] = imagePath;
+    header["width"] = width;
+    header["height"] = height;
+    m_file.write(QJsonDocument(header).toJson(QJsonDocument::Compact) + '\n');
+    m_file.flush();
+
+    m_clock.start();
+    return true;
+}
+
+void InteractionRecorder::stop() {
+    if (m_file.isOpen()) {
+        m_file.close();
+    }
+}
+
+void InteractionRecorder::autoColor(const QPoint& pos, int tolerance, const QRect& viewport) {
+    InteractionEvent event;
+    event.type = InteractionEvent::AutoColor;
+    event.pos = pos;
+    event.tolerance = tolerance;
+    event.viewport = viewport;
+    write(event);
+}
+
+void InteractionRecorder::strokeBegin(InteractionEvent::Tool tool, const QPoint& pos, int brushSize, float hardness) {
+    InteractionEvent event;
+    event.type = InteractionEvent::StrokeBegin;
+    event.tool = tool;
+    event.pos = pos;
+    event.brushSize = brushSize;
+    event.hardness = hardness;
+    write(event);
+}
+
+void InteractionRecorder::strokeMove(const QPoint& pos) {
+    InteractionEvent event;
+    event.type = InteractionEvent::StrokeMove;
+    event.pos = pos;
+    write(event);
+}
+
+void InteractionRecorder::strokeEnd() {
+    InteractionEvent event;
+    event.type = InteractionEvent::StrokeEnd;
+    write(event);
+}
+
+void InteractionRecorder::undo() {
+    InteractionEvent event;
+    event.type = InteractionEvent::Undo;
+    write(event);
+}
+
+void InteractionRecorder::redo() {
+    InteractionEvent event;
+    event.type = InteractionEvent::Redo;
+    write(event);
+}
+
+void InteractionRecorder::write(InteractionEvent event) {
+    if (!m_file.isOpen()) return;
+
+    QJsonObject object;
+    object["type"] = InteractionEvent::typeName(event.type);
+    object["t"] = m_clock.elapsed();
+    switch (event.type) {
+        case InteractionEvent::AutoColor:
+            object["x"] = event.pos.x();
+            object["y"] = event.pos.y();
+            object["tolerance"] = event.tolerance;
+            if (event.viewport.isValid()) {
+                object["viewport"] = QJsonArray{event.viewport.x(), event.viewport.y(),
+                                                event.viewport.width(), event.viewport.height()};
+            }
+            break;
+        case InteractionEvent::StrokeBegin:
+            object["tool"] = toolName(event.tool);
+            object["size"] = event.brushSize;
+            object["hardness"] = event.hardness;
+            Q_FALLTHROUGH();
+        case InteractionEvent::StrokeMove:
+            object["x"] = event.pos.x();
+            object["y"] = event.pos.y();
+            break;
+        default:
+            break;
+    }
+
+    m_file.write(QJsonDocument(object).toJson(QJsonDocument::Compact) + '\n');
+    m_file.flush();
+}
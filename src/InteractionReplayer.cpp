@@ -0,0 +1,180 @@
+#include "InteractionReplayer.h"
+#include "HistoryManager.h"
+#include "ImageProcessor.h"
+#include <QElapsedTimer>
+#include <QThread>
+#include <algorithm>
+#include <map>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+// Same cut-off as CanvasWidget - above it only the viewport is rendered after a full change
+constexpr int LARGE_IMAGE_THRESHOLD = 8300000;
+
+double percentile(const std::vector<double>& sorted, double fraction) {
+    if (sorted.empty()) return 0.0;
+    size_t rank = static_cast<size_t>(fraction * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(rank, sorted.size() - 1)];
+}
+
+InteractionReplayer::EventStats summarise(const QString& name, std::vector<double> samples) {
+    InteractionReplayer::EventStats stats;
+    stats.name = name;
+    stats.count = static_cast<int>(samples.size());
+    std::sort(samples.begin(), samples.end());
+    stats.p50Ms = percentile(samples, 0.50);
+    stats.p90Ms = percentile(samples, 0.90);
+    stats.p99Ms = percentile(samples, 0.99);
+    stats.maxMs = samples.empty() ? 0.0 : samples.back();
+    for (double sample : samples) {
+        stats.totalMs += sample;
+    }
+    return stats;
+}
+
+} // namespace
+
+InteractionReplayer::InteractionReplayer(ImageProcessor* processor, HistoryManager* history)
+    : m_processor(processor)
+    , m_history(history)
+{
+}
+
+size_t InteractionReplayer::peakResidentBytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return static_cast<size_t>(counters.PeakWorkingSetSize);
+    }
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef __APPLE__
+        return static_cast<size_t>(usage.ru_maxrss);          // Bytes
+#else
+        return static_cast<size_t>(usage.ru_maxrss) * 1024;   // KiB
+#endif
+    }
+#endif
+    return 0;
+}
+
+void InteractionReplayer::refreshDisplay(const QRect& imageRect) {
+    m_processor->updateDisplayRegion(m_displayImage, imageRect);
+}
+
+void InteractionReplayer::apply(const InteractionEvent& event) {
+    int width = m_processor->getWidth();
+    int height = m_processor->getHeight();
+    QRect fullImage(0, 0, width, height);
+
+    switch (event.type) {
+        case InteractionEvent::AutoColor: {
+            m_history->saveStateBeforeChange();
+            m_processor->autoColorRemove(event.pos.x(), event.pos.y(), event.tolerance, event.viewport);
+            m_history->saveState();
+
+            // Canvas rebuilds its whole cache after a fill
+            bool large = static_cast<qint64>(width) * height > LARGE_IMAGE_THRESHOLD;
+            refreshDisplay(large && event.viewport.isValid() ? event.viewport : fullImage);
+            m_processor->getOriginalAsQImage();
+            break;
+        }
+        case InteractionEvent::StrokeBegin: {
+            m_stroke = event;
+            m_lastStrokePos = event.pos;
+            m_history->saveStateBeforeChange();
+
+            int brushSize = m_stroke.brushSize;
+            if (m_stroke.tool == InteractionEvent::Erase) {
+                m_processor->eraseWithBrush(event.pos.x(), event.pos.y(), brushSize, m_stroke.hardness);
+            } else {
+                m_processor->repairWithBrush(event.pos.x(), event.pos.y(), brushSize);
+            }
+            refreshDisplay(QRect(event.pos.x() - brushSize, event.pos.y() - brushSize,
+                                 brushSize * 2, brushSize * 2));
+            break;
+        }
+        case InteractionEvent::StrokeMove: {
+            int brushSize = m_stroke.brushSize;
+            int minX = std::min(m_lastStrokePos.x(), event.pos.x()) - brushSize;
+            int minY = std::min(m_lastStrokePos.y(), event.pos.y()) - brushSize;
+            int maxX = std::max(m_lastStrokePos.x(), event.pos.x()) + brushSize;
+            int maxY = std::max(m_lastStrokePos.y(), event.pos.y()) + brushSize;
+
+            if (m_stroke.tool == InteractionEvent::Erase) {
+                m_processor->eraseAlongPath(m_lastStrokePos, event.pos, brushSize, m_stroke.hardness);
+            } else {
+                m_processor->repairAlongPath(m_lastStrokePos, event.pos, brushSize);
+            }
+            m_lastStrokePos = event.pos;
+            refreshDisplay(QRect(minX, minY, maxX - minX, maxY - minY));
+            break;
+        }
+        case InteractionEvent::StrokeEnd:
+            m_history->saveState();
+            break;
+        case InteractionEvent::Undo:
+            if (m_history->canUndo()) {
+                for (const QRect& rect : m_history->undo()) {
+                    refreshDisplay(rect);
+                }
+            }
+            break;
+        case InteractionEvent::Redo:
+            if (m_history->canRedo()) {
+                for (const QRect& rect : m_history->redo()) {
+                    refreshDisplay(rect);
+                }
+            }
+            break;
+    }
+}
+
+InteractionReplayer::Report InteractionReplayer::replay(const InteractionLog& log) {
+    Report report;
+    if (!m_processor || !m_history || !m_processor->hasImage()) return report;
+
+    m_history->saveInitialState();
+    m_displayImage = QImage(m_processor->getWidth(), m_processor->getHeight(), QImage::Format_ARGB32_Premultiplied);
+    refreshDisplay(QRect(0, 0, m_processor->getWidth(), m_processor->getHeight()));
+
+    std::map<InteractionEvent::Type, std::vector<double>> samples;
+    std::vector<double> all;
+    all.reserve(log.events.size());
+
+    QElapsedTimer clock;
+    clock.start();
+    QElapsedTimer timer;
+    for (const InteractionEvent& event : log.events) {
+        if (m_paced && event.timeMs > clock.elapsed()) {
+            QThread::msleep(static_cast<unsigned long>(event.timeMs - clock.elapsed()));
+        }
+
+        timer.start();
+        apply(event);
+        double ms = timer.nsecsElapsed() / 1e6;
+
+        samples[event.type].push_back(ms);
+        all.push_back(ms);
+    }
+
+    for (const auto& entry : samples) {
+        report.events.append(summarise(InteractionEvent::typeName(entry.first), entry.second));
+    }
+    report.events.append(summarise("all", all));
+    report.totalMs = report.events.last().totalMs;
+    report.peakRssBytes = peakResidentBytes();
+    return report;
+}
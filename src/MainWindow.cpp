@@ -7,6 +7,7 @@
 #include "ResizeDialog.h"
 #include "UpscaleDialog.h"
 #include "Upscaler.h"
+#include "ExportQueue.h"
 #include "UpdateChecker.h"
 #include "Version.h"
 
@@ -28,6 +29,9 @@
 #include <QtConcurrent>
 #include <QFutureWatcher>
 #include <QDesktopServices>
+#include <QDebug>
+#include <QInputDialog>
+#include <algorithm>
 
 MainWindow::MainWindow(QWidget* parent)
     : QMainWindow(parent)
@@ -35,6 +39,8 @@ MainWindow::MainWindow(QWidget* parent)
     , m_toolManager(new ToolManager(this))
     , m_historyManager(new HistoryManager(this))
     , m_updateChecker(new UpdateChecker(this))
+    , m_upscaler(new Upscaler(this))
+    , m_exportQueue(new ExportQueue(this))
 {
     setWindowTitle("PixelEraser Pro");
     setWindowIcon(QIcon(":/icons/app-icon.png"));  // Set window icon explicitly
@@ -101,6 +107,7 @@ void MainWindow::setupMenuBar() {
     
     fileMenu->addAction("New", this, [this]() {
         if (confirmSaveBeforeClose()) {
+            stopSessionRecording();
             m_processor->clear();
             m_historyManager->clear();
             m_canvas->updateDisplay();
@@ -114,6 +121,8 @@ void MainWindow::setupMenuBar() {
     fileMenu->addAction("Discard Image", this, &MainWindow::discardImage, QKeySequence("Ctrl+D"));
     fileMenu->addSeparator();
     fileMenu->addAction("Export...", this, &MainWindow::quickExport, QKeySequence("Ctrl+E"));
+    fileMenu->addAction("Export with Preview...", this, &MainWindow::exportFile, QKeySequence("Ctrl+Alt+E"));
+    fileMenu->addAction("Export Sizes...", this, &MainWindow::exportSizes, QKeySequence("Ctrl+Shift+E"));
     fileMenu->addSeparator();
     fileMenu->addAction("Exit", this, &QMainWindow::close, QKeySequence("Alt+F4"));
 
@@ -160,6 +169,10 @@ void MainWindow::setupMenuBar() {
     helpMenu->addAction("Keyboard Shortcuts", this, &MainWindow::showShortcuts, QKeySequence("F1"));
     helpMenu->addAction("Check for Updates...", this, &MainWindow::checkForUpdates);
     helpMenu->addSeparator();
+    m_recordSessionAction = helpMenu->addAction("Record Session...", this, &MainWindow::toggleSessionRecording);
+    m_recordSessionAction->setCheckable(true);
+    m_recordSessionAction->setToolTip("Log tool events for pixeleraser-replay latency regression runs");
+    helpMenu->addSeparator();
     helpMenu->addAction("About", this, [this]() {
         QMessageBox::about(this, "About PixelEraser Pro",
             QString("PixelEraser Pro v%1\n\n"
@@ -450,6 +463,12 @@ void MainWindow::setupShortcuts() {
 
 void MainWindow::connectSignals() {
     connect(m_toolGroup, &QButtonGroup::idClicked, this, &MainWindow::onToolChanged);
+
+    // Exports report from worker threads - queued onto the GUI thread
+    connect(m_exportQueue, &ExportQueue::progress, this, [this](int jobId, ExportQueue::Stage stage, int percent) {
+        onExportProgress(jobId, stage, percent);
+    });
+    connect(m_exportQueue, &ExportQueue::finished, this, &MainWindow::onExportFinished);
     
     // Tolerance - sync slider and spinbox
     connect(m_toleranceSlider, &QSlider::valueChanged, this, [this](int v) {
@@ -561,27 +580,72 @@ void MainWindow::dropEvent(QDropEvent* event) {
 }
 
 void MainWindow::loadImageFile(const QString& path) {
-    // Show loading indicator
+    if (m_isLoading) {
+        statusBar()->showMessage("Still opening the previous image...", 2000);
+        return;
+    }
+    m_isLoading = true;
+    m_loadTimer.start();
+    m_loadPreviewMs = -1;
+
+    // The current image, history and path stay until the new image decodes, so a failed
+    // open loses nothing. The canvas is locked meanwhile so no edit lands on the old image.
+    m_canvas->setEnabled(false);
+
     showProgress(true, "Loading image...");
     statusBar()->showMessage("Loading image...");
-    QApplication::processEvents();
-    
-    if (m_processor->loadImage(path)) {
+
+    auto* watcher = new QFutureWatcher<cv::Mat>(this);
+    connect(watcher, &QFutureWatcher<cv::Mat>::finished, this, [this, watcher, path]() {
+        cv::Mat image = watcher->result();
+        watcher->deleteLater();
+        m_isLoading = false;
+        m_canvas->setEnabled(true);
+        showProgress(false);
+
+        if (image.empty()) {
+            m_canvas->clearLoadingPreview();
+            if (m_processor->hasImage()) m_canvas->fitToScreen();
+            updateStatusBar();
+            QMessageBox::critical(this, "Error", "Failed to load image:\n" + path);
+            return;
+        }
+
+        stopSessionRecording();
+        m_historyManager->clear();
+        m_processor->replaceImage(image);
         m_currentFilePath = path;
         m_historyManager->saveInitialState();  // Save initial state for undo
         m_canvas->loadImage(path);
         m_canvas->fitToScreen();
         updateStatusBar();
-        
+
         QFileInfo fi(path);
         setWindowTitle(QString("PixelEraser Pro - %1").arg(fi.fileName()));
-        
-        showProgress(false);
-        statusBar()->showMessage(QString("Loaded: %1 x %2").arg(m_processor->getWidth()).arg(m_processor->getHeight()), 3000);
-    } else {
-        showProgress(false);
-        QMessageBox::critical(this, "Error", "Failed to load image:\n" + path);
-    }
+
+        qint64 fullMs = m_loadTimer.elapsed();
+        qint64 firstPixelMs = m_loadPreviewMs >= 0 ? m_loadPreviewMs : fullMs;
+        qDebug() << "Open" << fi.fileName() << "- first pixels" << firstPixelMs << "ms, full image" << fullMs << "ms";
+        statusBar()->showMessage(QString("Loaded: %1 x %2 (first pixels %3 ms, full image %4 ms)")
+                                     .arg(m_processor->getWidth()).arg(m_processor->getHeight())
+                                     .arg(firstPixelMs).arg(fullMs), 5000);
+    });
+
+    watcher->setFuture(QtConcurrent::run([this, path]() {
+        QSize fullSize;
+        QImage preview = ImageProcessor::decodePreview(path, LOAD_PREVIEW_MAX_SIDE, &fullSize);
+        if (!preview.isNull()) {
+            QMetaObject::invokeMethod(this, [this, preview, fullSize]() {
+                // Full decode may already have landed
+                if (!m_isLoading) return;
+                m_loadPreviewMs = m_loadTimer.elapsed();
+                m_canvas->showLoadingPreview(preview, fullSize);
+                statusBar()->showMessage(QString("Loading %1 x %2 image...")
+                                             .arg(fullSize.width()).arg(fullSize.height()));
+            }, Qt::QueuedConnection);
+        }
+        return ImageProcessor::decodeImage(path);
+    }));
 }
 
 void MainWindow::openFile() {
@@ -589,7 +653,7 @@ void MainWindow::openFile() {
     
     QString filename = QFileDialog::getOpenFileName(
         this, "Open Image", QString(),
-        "Images (*.png *.jpg *.jpeg *.bmp *.webp *.tiff);;All Files (*.*)"
+        "Images (*.png *.jpg *.jpeg *.bmp *.webp *.tiff *.qoi);;All Files (*.*)"
     );
 
     if (!filename.isEmpty()) {
@@ -613,6 +677,7 @@ void MainWindow::discardImage() {
     
     if (msgBox.exec() == QMessageBox::Yes) {
         // Clear everything without asking to save
+        stopSessionRecording();
         m_processor->clear();
         m_historyManager->clear();
         m_canvas->updateDisplay();
@@ -623,25 +688,50 @@ void MainWindow::discardImage() {
     }
 }
 
-void MainWindow::quickExport() {
-    if (!m_processor->hasImage()) return;
-    
+QString MainWindow::defaultExportPath() const {
     // Use original filename by default
-    QString defaultPath;
     if (!m_currentFilePath.isEmpty()) {
         QFileInfo fi(m_currentFilePath);
-        defaultPath = fi.absolutePath() + "/" + fi.completeBaseName() + ".png";
-    } else {
-        defaultPath = "exported.png";
+        return fi.absolutePath() + "/" + fi.completeBaseName() + "." + m_exportFormat;
+    }
+    return "exported." + m_exportFormat;
+}
+
+QString MainWindow::chooseExportPath(const QString& title, int& quality) {
+    QStringList formats = ImageProcessor::exportFormats();
+    QStringList filters;
+    for (const QString& format : formats) {
+        filters << ImageProcessor::formatFilter(format);
+    }
+
+    // The chosen filter decides the extension when none of ours was typed
+    QString selectedFilter = ImageProcessor::formatFilter(m_exportFormat);
+    QString path = QFileDialog::getSaveFileName(this, title, defaultExportPath(), filters.join(";;"), &selectedFilter);
+    if (path.isEmpty()) return path;
+
+    QString format = QFileInfo(path).suffix().toLower();
+    if (!formats.contains(format)) {
+        format = formats.value(filters.indexOf(selectedFilter), "png");
+        path += "." + format;
+    }
+
+    quality = 100;
+    if (ImageProcessor::formatHasQuality(format)) {
+        bool ok = false;
+        quality = QInputDialog::getInt(this, title, "Quality (100 = lossless):", 100, 1, 100, 1, &ok);
+        if (!ok) return QString();
     }
+    m_exportFormat = format;
+    return path;
+}
+
+void MainWindow::quickExport() {
+    if (!m_processor->hasImage()) return;
     
-    QString path = QFileDialog::getSaveFileName(this, "Export Image", defaultPath, "PNG (*.png)");
+    int quality = 100;
+    QString path = chooseExportPath("Export Image", quality);
     
     if (!path.isEmpty()) {
-        if (!path.endsWith(".png", Qt::CaseInsensitive)) {
-            path += ".png";
-        }
-        
         // Ask if user wants to resize before export
         QMessageBox resizeBox(this);
         resizeBox.setWindowTitle("Resize Before Export?");
@@ -668,29 +758,131 @@ void MainWindow::quickExport() {
             }
         }
         
-        // Show progress
-        showProgress(true, "Exporting...");
-        statusBar()->showMessage("Exporting...");
-        QApplication::processEvents();
-        
-        // Get softening value from slider
-        int softening = m_softeningSlider->value();
-        
-        if (m_processor->exportImage(path, softening)) {
-            showProgress(false);
-            QMessageBox::information(this, "Export Successful", 
-                QString("Image exported successfully!\n\n%1").arg(path));
-            statusBar()->showMessage("Export complete", 3000);
-        } else {
-            showProgress(false);
-            QMessageBox::critical(this, "Error", "Failed to export image.");
+        ExportOptions options;
+        options.pngPreset = m_pngPreset;
+        options.quality = quality;
+        startExport(path, options, m_softeningSlider->value());
+    }
+}
+
+void MainWindow::exportSizes() {
+    if (!m_processor->hasImage()) return;
+
+    int quality = 100;
+    QString path = chooseExportPath("Export Sizes", quality);
+    if (path.isEmpty()) return;
+
+    bool ok = false;
+    QString text = QInputDialog::getText(this, "Export Sizes",
+        QString("Longest side of each size in pixels.\nFiles are named <name>_<size>.%1:")
+            .arg(QFileInfo(path).suffix()),
+        QLineEdit::Normal, "2048, 1200, 800, 400, 200", &ok);
+    if (!ok) return;
+
+    int longest = std::max(m_processor->getWidth(), m_processor->getHeight());
+    std::vector<int> sides;
+    for (const QString& part : text.split(',', Qt::SkipEmptyParts)) {
+        int side = part.trimmed().toInt();
+        if (side > 0 && side < longest && std::find(sides.begin(), sides.end(), side) == sides.end()) {
+            sides.push_back(side);
         }
     }
+    if (sides.empty()) {
+        QMessageBox::warning(this, "Export Sizes",
+            QString("Enter at least one size below the image's longest side (%1 px).").arg(longest));
+        return;
+    }
+
+    ExportOptions options;
+    options.pngPreset = m_pngPreset;
+    options.quality = quality;
+    startExport(path, options, m_softeningSlider->value(), sides);
+}
+
+void MainWindow::startExport(const QString& path, const ExportOptions& options, int softenLevel,
+                             const std::vector<int>& longestSides) {
+    // Runs in the background on a snapshot - editing can continue meanwhile
+    ExportQueue::Request request;
+    request.path = path;
+    request.softenLevel = softenLevel;
+    request.options = options;
+    request.longestSides = longestSides;
+    int jobId = m_exportQueue->enqueue(m_processor->getCurrentImage(), request);
+
+    ExportStatus status;
+    status.fileName = QFileInfo(path).fileName();
+    status.stage = ExportQueue::stageName(request.softenLevel > 0 ? ExportQueue::Softening
+                                                                  : ExportQueue::Encoding);
+    status.files = longestSides.empty() ? 1 : static_cast<int>(longestSides.size());
+    m_exports.insert(jobId, status);
+    updateExportProgress();
+    statusBar()->showMessage("Exporting " + status.fileName + "...", 2000);
+}
+
+void MainWindow::onExportProgress(int jobId, int stage, int percent) {
+    auto it = m_exports.find(jobId);
+    if (it == m_exports.end()) return;
+
+    // Softening and resizing are quick next to deflate; writing is a buffered copy
+    switch (stage) {
+        case ExportQueue::Softening: it->percent = percent * 15 / 100; break;
+        case ExportQueue::Resizing: it->percent = 15 + percent / 10; break;
+        case ExportQueue::Encoding: it->percent = 25 + percent * 65 / 100; break;
+        case ExportQueue::Writing: it->percent = 90 + percent / 10; break;
+    }
+    it->stage = ExportQueue::stageName(static_cast<ExportQueue::Stage>(stage));
+    updateExportProgress();
+}
+
+void MainWindow::onExportFinished(int jobId, const QString& path, bool success) {
+    int files = m_exports.value(jobId).files;
+    m_exports.remove(jobId);
+    updateExportProgress();
+
+    if (success && files > 1) {
+        statusBar()->showMessage(QString("Exported %1 sizes of %2").arg(files).arg(path), 5000);
+    } else if (success) {
+        statusBar()->showMessage("Exported " + path, 5000);
+    } else {
+        QMessageBox::critical(this, "Error", "Failed to export image:\n" + path);
+    }
+}
+
+void MainWindow::updateExportProgress() {
+    if (m_exports.isEmpty()) {
+        showProgress(false);
+        return;
+    }
+
+    int total = 0;
+    for (const ExportStatus& status : m_exports) {
+        total += status.percent;
+    }
+    m_progressBar->setVisible(true);
+    m_progressBar->setRange(0, 100);
+    m_progressBar->setValue(total / m_exports.size());
+    if (m_exports.size() == 1) {
+        const ExportStatus& status = m_exports.constBegin().value();
+        m_progressBar->setFormat(QString("%1: %2 %p%").arg(status.fileName, status.stage));
+    } else {
+        m_progressBar->setFormat(QString("%1 exports: %p%").arg(m_exports.size()));
+    }
 }
 
 void MainWindow::exportFile() {
-    // Just use quickExport - no need for separate dialog
-    quickExport();
+    if (!m_processor->hasImage()) return;
+
+    // Format, quality and softening in one dialog, with a softened preview
+    ExportDialog dialog(m_processor, this);
+    dialog.setExportPath(defaultExportPath());
+    dialog.setSofteningLevel(m_softeningSlider->value());
+    dialog.setPngPreset(m_pngPreset);
+    if (dialog.exec() != QDialog::Accepted) return;
+
+    ExportOptions options = dialog.getExportOptions();
+    m_exportFormat = dialog.getExportFormat();
+    m_pngPreset = options.pngPreset;
+    startExport(dialog.getExportPath(), options, dialog.getSofteningLevel());
 }
 
 void MainWindow::resizeImage() {
@@ -705,6 +897,7 @@ void MainWindow::resizeImage() {
         int newH = dialog.getNewHeight();
         
         if (newW != m_processor->getWidth() || newH != m_processor->getHeight()) {
+            stopSessionRecording();  // Replays can't follow a size change
             m_historyManager->saveStateBeforeChange();
             m_processor->resize(newW, newH);
             m_historyManager->saveState();
@@ -738,6 +931,26 @@ void MainWindow::upscaleImage() {
         // Get input image
         cv::Mat inputImage = m_processor->getCurrentImage().clone();
         
+        // Cut-outs pick how their edge is upscaled - opaque alpha comes out the same every way
+        Upscaler::AlphaMode alphaMode = Upscaler::AlphaBicubic;
+        double minAlpha = 255.0;
+        if (inputImage.channels() == 4) {
+            cv::Mat alpha;
+            cv::extractChannel(inputImage, alpha, 3);
+            cv::minMaxLoc(alpha, &minAlpha);
+        }
+        if (minAlpha < 255.0) {
+            QStringList modes = {"Bicubic - fastest, soft edges",
+                                 "Guided - edges follow the upscaled colour",
+                                 "AI model - sharpest, one extra tile per tile"};
+            bool ok = false;
+            QString mode = QInputDialog::getItem(this, "Upscale", "Transparent edges:", modes,
+                                                 m_upscaleAlphaMode, false, &ok);
+            if (!ok) return;
+            m_upscaleAlphaMode = modes.indexOf(mode);
+            alphaMode = static_cast<Upscaler::AlphaMode>(m_upscaleAlphaMode);
+        }
+        
         // Create progress dialog
         QProgressDialog* progressDialog = new QProgressDialog(this);
         progressDialog->setWindowTitle("AI Upscaling");
@@ -745,14 +958,23 @@ void MainWindow::upscaleImage() {
         progressDialog->setRange(0, 0);  // Indeterminate initially
         progressDialog->setMinimumDuration(0);
         progressDialog->setWindowModality(Qt::WindowModal);
-        progressDialog->setCancelButton(nullptr);  // Can't cancel mid-upscale
+        progressDialog->setCancelButtonText("Cancel");
+        progressDialog->setAutoClose(false);
+        progressDialog->setAutoReset(false);
         progressDialog->setMinimumWidth(350);
         progressDialog->show();
         QApplication::processEvents();
         
-        // Create upscaler and connect progress signal (use Qt::QueuedConnection for thread safety)
-        Upscaler* upscaler = new Upscaler();
-        connect(upscaler, &Upscaler::progressChanged, this, [progressDialog](int progress) {
+        // Connect progress for this run only (upscaler is shared across runs)
+        Upscaler* upscaler = m_upscaler;
+        upscaler->setAlphaMode(alphaMode);
+        connect(progressDialog, &QProgressDialog::canceled, upscaler, &Upscaler::cancel);
+        
+        // Finished tiles appear on the canvas while the rest are still running
+        upscaler->setTilePreviewEnabled(true);
+        QMetaObject::Connection previewConnection = connect(upscaler, &Upscaler::tilePreviewReady,
+                                                            m_canvas, &CanvasWidget::showPreviewTile);
+        QMetaObject::Connection progressConnection = connect(upscaler, &Upscaler::progressChanged, progressDialog, [progressDialog](int progress) {
             if (progressDialog->maximum() == 0) {
                 progressDialog->setRange(0, 100);  // Switch to determinate
             }
@@ -763,22 +985,22 @@ void MainWindow::upscaleImage() {
         // Run upscaling in background thread
         QFutureWatcher<cv::Mat>* watcher = new QFutureWatcher<cv::Mat>(this);
         
-        connect(watcher, &QFutureWatcher<cv::Mat>::finished, this, [this, watcher, progressDialog, upscaler, scale]() {
+        connect(watcher, &QFutureWatcher<cv::Mat>::finished, this, [this, watcher, progressDialog, progressConnection, previewConnection, scale]() {
             cv::Mat result = watcher->result();
             
+            disconnect(progressConnection);
+            disconnect(previewConnection);
+            m_canvas->clearPreviewTiles();
             progressDialog->close();
             progressDialog->deleteLater();
-            upscaler->deleteLater();
             watcher->deleteLater();
             
             if (!result.empty()) {
+                stopSessionRecording();
                 m_historyManager->saveStateBeforeChange();
                 
-                // Replace current image with upscaled result
-                m_processor->getCurrentImage() = result;
-                
-                // CRITICAL: Update original image AND LAB cache for accurate Auto Color Remove
-                m_processor->updateOriginalImage();
+                // Upscaled result becomes both current and original (repair source)
+                m_processor->replaceImage(result);
                 
                 // Force complete rebuild of display cache
                 m_canvas->updateDisplay();
@@ -786,10 +1008,16 @@ void MainWindow::upscaleImage() {
                 m_historyManager->saveState();
                 m_canvas->fitToScreen();
                 updateStatusBar();
-                statusBar()->showMessage(QString("Upscaled %1x to %2 x %3")
+                Upscaler::UpscaleStats stats = m_upscaler->lastStats();
+                statusBar()->showMessage(QString("Upscaled %1x to %2 x %3 (%4 tiles/s, %5 px tiles, %6)")
                     .arg(scale)
                     .arg(result.cols)
-                    .arg(result.rows), 3000);
+                    .arg(result.rows)
+                    .arg(stats.tilesPerSecond, 0, 'f', 1)
+                    .arg(stats.tileSize)
+                    .arg(Upscaler::getPrecisionName(stats.precision)), 5000);
+            } else if (m_upscaler->wasCancelled()) {
+                statusBar()->showMessage("Upscale cancelled", 3000);
             } else {
                 QMessageBox::critical(this, "Error", "Failed to upscale image.");
             }
@@ -816,7 +1044,7 @@ void MainWindow::showShortcuts() {
         "  Ctrl+S            Save\n"
         "  Ctrl+Shift+S      Save As\n"
         "  Ctrl+E            Quick Export\n"
-        "  Ctrl+Shift+E      Export\n\n"
+        "  Ctrl+Shift+E      Export Sizes\n\n"
         "EDIT\n"
         "  Ctrl+Z            Undo\n"
         "  Ctrl+Y            Redo\n"
@@ -848,16 +1076,14 @@ void MainWindow::showProgress(bool show, const QString& message) {
 
 void MainWindow::undo() {
     if (m_historyManager->canUndo()) {
-        m_historyManager->undo();
-        m_canvas->updateDisplay();
+        m_canvas->updateRegions(m_historyManager->undo());
         statusBar()->showMessage(QString("Undo (%1 remaining)").arg(m_historyManager->undoSteps()), 1500);
     }
 }
 
 void MainWindow::redo() {
     if (m_historyManager->canRedo()) {
-        m_historyManager->redo();
-        m_canvas->updateDisplay();
+        m_canvas->updateRegions(m_historyManager->redo());
         statusBar()->showMessage(QString("Redo (%1 remaining)").arg(m_historyManager->redoSteps()), 1500);
     }
 }
@@ -903,6 +1129,37 @@ void MainWindow::updateStatusBar() {
     m_redoAction->setEnabled(m_historyManager->canRedo());
 }
 
+void MainWindow::toggleSessionRecording() {
+    if (m_canvas->isRecording()) {
+        stopSessionRecording();
+        statusBar()->showMessage("Session recording saved", 3000);
+        return;
+    }
+
+    if (!m_processor->hasImage()) {
+        m_recordSessionAction->setChecked(false);
+        QMessageBox::warning(this, "Record Session", "Open an image before recording a session.");
+        return;
+    }
+
+    QString path = QFileDialog::getSaveFileName(this, "Record Session", "session.jsonl",
+                                                "Interaction Logs (*.jsonl)");
+    if (path.isEmpty() || !m_canvas->startRecording(path, m_currentFilePath)) {
+        m_recordSessionAction->setChecked(false);
+        if (!path.isEmpty()) {
+            QMessageBox::critical(this, "Error", "Failed to create session log:\n" + path);
+        }
+        return;
+    }
+    m_recordSessionAction->setChecked(true);
+    statusBar()->showMessage("Recording session - tool events are logged until stopped", 3000);
+}
+
+void MainWindow::stopSessionRecording() {
+    m_canvas->stopRecording();
+    m_recordSessionAction->setChecked(false);
+}
+
 void MainWindow::checkForUpdates() {
     statusBar()->showMessage("Checking for updates...");
     m_updateChecker->checkForUpdates(false);  // Not silent - show dialogs
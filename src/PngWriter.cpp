@@ -0,0 +1,366 @@
+#include "PngWriter.h"
+#include <QSaveFile>
+#include <QThread>
+#include <zlib.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+constexpr size_t WINDOW_BYTES = 32768;             // Deflate window - how far back a stripe can match
+
+enum Filter { FilterNone, FilterSub, FilterUp, FilterAverage, FilterPaeth, FilterCount };
+
+struct Settings {
+    int level;
+    bool adaptive;                                  // Pick the cheapest filter per row, else always Up
+};
+
+Settings settingsFor(PngWriter::Preset preset) {
+    switch (preset) {
+        case PngWriter::Fast: return {1, false};
+        case PngWriter::Balanced: return {6, true};
+        case PngWriter::Small: return {9, true};
+    }
+    return {6, true};
+}
+
+struct Stripe {
+    std::vector<uchar> chunk;                       // Complete IDAT chunk - length, tag, data, CRC
+    uLong adler = 1;                                // Adler-32 of this stripe's filtered rows
+    size_t length = 0;                              // Filtered bytes covered
+    bool ok = false;
+};
+
+void putU32(uchar* out, uint32_t value) {
+    out[0] = static_cast<uchar>(value >> 24);
+    out[1] = static_cast<uchar>(value >> 16);
+    out[2] = static_cast<uchar>(value >> 8);
+    out[3] = static_cast<uchar>(value);
+}
+
+// Length, tag and payload, then the CRC over tag and payload
+std::vector<uchar> makeChunk(const char* tag, const uchar* data, size_t size) {
+    std::vector<uchar> chunk(size + 12);
+    putU32(chunk.data(), static_cast<uint32_t>(size));
+    std::memcpy(chunk.data() + 4, tag, 4);
+    if (size > 0) {
+        std::memcpy(chunk.data() + 8, data, size);
+    }
+    uLong crc = crc32(0L, chunk.data() + 4, static_cast<uInt>(size + 4));
+    putU32(chunk.data() + 8 + size, static_cast<uint32_t>(crc));
+    return chunk;
+}
+
+// One row in PNG channel order (RGB / RGBA)
+void toPngOrder(const cv::Mat& image, int y, uchar* out) {
+    const uchar* src = image.ptr<uchar>(y);
+    int channels = image.channels();
+    if (channels == 1) {
+        std::memcpy(out, src, image.cols);
+        return;
+    }
+    for (int x = 0; x < image.cols; ++x, src += channels, out += channels) {
+        out[0] = src[2];
+        out[1] = src[1];
+        out[2] = src[0];
+        if (channels == 4) out[3] = src[3];
+    }
+}
+
+inline uchar paeth(int a, int b, int c) {
+    int p = a + b - c;
+    int pa = std::abs(p - a);
+    int pb = std::abs(p - b);
+    int pc = std::abs(p - c);
+    if (pa <= pb && pa <= pc) return static_cast<uchar>(a);
+    if (pb <= pc) return static_cast<uchar>(b);
+    return static_cast<uchar>(c);
+}
+
+// prev is all zeros for the first row, as the PNG spec defines
+void filterRow(Filter filter, const uchar* cur, const uchar* prev, int bytes, int bpp, uchar* out) {
+    switch (filter) {
+        case FilterNone:
+            std::memcpy(out, cur, bytes);
+            break;
+        case FilterSub:
+            for (int i = 0; i < bpp; ++i) out[i] = cur[i];
+            for (int i = bpp; i < bytes; ++i) out[i] = static_cast<uchar>(cur[i] - cur[i - bpp]);
+            break;
+        case FilterUp:
+            for (int i = 0; i < bytes; ++i) out[i] = static_cast<uchar>(cur[i] - prev[i]);
+            break;
+        case FilterAverage:
+            for (int i = 0; i < bpp; ++i) out[i] = static_cast<uchar>(cur[i] - (prev[i] >> 1));
+            for (int i = bpp; i < bytes; ++i) {
+                out[i] = static_cast<uchar>(cur[i] - ((cur[i - bpp] + prev[i]) >> 1));
+            }
+            break;
+        case FilterPaeth:
+            for (int i = 0; i < bpp; ++i) out[i] = static_cast<uchar>(cur[i] - prev[i]);
+            for (int i = bpp; i < bytes; ++i) {
+                out[i] = static_cast<uchar>(cur[i] - paeth(cur[i - bpp], prev[i], prev[i - bpp]));
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+// Sum of absolute signed residuals - libpng's heuristic for picking a filter
+long filterCost(const uchar* data, int bytes) {
+    long cost = 0;
+    for (int i = 0; i < bytes; ++i) {
+        cost += std::abs(static_cast<signed char>(data[i]));
+    }
+    return cost;
+}
+
+class StripeEncoder {
+public:
+    StripeEncoder(const cv::Mat& image, Settings settings, int stripeRows)
+        : m_image(image)
+        , m_settings(settings)
+        , m_stripeRows(stripeRows)
+        , m_bpp(image.channels())
+        , m_rowBytes(image.cols * image.channels())
+        , m_filteredRowBytes(static_cast<size_t>(m_rowBytes) + 1)
+    {
+    }
+
+    int stripeCount() const { return (m_image.rows + m_stripeRows - 1) / m_stripeRows; }
+
+    Stripe encode(int index) const {
+        Stripe stripe;
+        int rowStart = index * m_stripeRows;
+        int rowEnd = std::min(m_image.rows, rowStart + m_stripeRows);
+        bool last = rowEnd == m_image.rows;
+
+        // Re-filter the rows just before the stripe to prime the window - filtering is
+        // deterministic, so these bytes match what the previous stripe compressed
+        int primeRows = static_cast<int>((WINDOW_BYTES + m_filteredRowBytes - 1) / m_filteredRowBytes);
+        int firstRow = std::max(0, rowStart - primeRows);
+
+        std::vector<uchar> filtered((rowEnd - firstRow) * m_filteredRowBytes);
+        filterRows(firstRow, rowEnd, filtered.data());
+
+        size_t prefixBytes = (rowStart - firstRow) * m_filteredRowBytes;
+        const uchar* own = filtered.data() + prefixBytes;
+        stripe.length = filtered.size() - prefixBytes;
+        stripe.adler = adler32(1L, own, static_cast<uInt>(stripe.length));
+
+        z_stream zs = {};
+        if (deflateInit2(&zs, m_settings.level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            return stripe;
+        }
+        if (prefixBytes > 0) {
+            size_t dictionaryBytes = std::min(prefixBytes, WINDOW_BYTES);
+            deflateSetDictionary(&zs, own - dictionaryBytes, static_cast<uInt>(dictionaryBytes));
+        }
+
+        // Room for the chunk header, the zlib header on stripe 0 and the sync-flush marker
+        size_t header = index == 0 ? 10 : 8;
+        std::vector<uchar> chunk(header + deflateBound(&zs, static_cast<uLong>(stripe.length)) + 16);
+        if (index == 0) {
+            int level = m_settings.level;
+            uchar cmf = 0x78;                       // Deflate, 32 KB window
+            uchar flg = static_cast<uchar>((level < 2 ? 0 : level < 6 ? 1 : level == 6 ? 2 : 3) << 6);
+            flg = static_cast<uchar>(flg + 31 - ((cmf * 256 + flg) % 31));
+            chunk[8] = cmf;
+            chunk[9] = flg;
+        }
+
+        zs.next_in = const_cast<Bytef*>(own);
+        zs.avail_in = static_cast<uInt>(stripe.length);
+        zs.next_out = chunk.data() + header;
+        zs.avail_out = static_cast<uInt>(chunk.size() - header - 4);
+
+        // Sync flush ends on a byte boundary without a final block, so the next stripe's
+        // raw deflate data can follow directly
+        int result = deflate(&zs, last ? Z_FINISH : Z_SYNC_FLUSH);
+        bool done = last ? result == Z_STREAM_END : (result == Z_OK && zs.avail_in == 0);
+        size_t dataBytes = (header - 8) + zs.total_out;
+        deflateEnd(&zs);
+        if (!done) return stripe;
+
+        chunk.resize(dataBytes + 12);
+        putU32(chunk.data(), static_cast<uint32_t>(dataBytes));
+        std::memcpy(chunk.data() + 4, "IDAT", 4);
+        uLong crc = crc32(0L, chunk.data() + 4, static_cast<uInt>(dataBytes + 4));
+        putU32(chunk.data() + 8 + dataBytes, static_cast<uint32_t>(crc));
+
+        stripe.chunk = std::move(chunk);
+        stripe.ok = true;
+        return stripe;
+    }
+
+private:
+    void filterRows(int firstRow, int rowEnd, uchar* out) const {
+        std::vector<uchar> prev(m_rowBytes, 0);
+        std::vector<uchar> cur(m_rowBytes);
+        std::vector<uchar> candidate(m_settings.adaptive ? m_rowBytes : 0);
+        if (firstRow > 0) {
+            toPngOrder(m_image, firstRow - 1, prev.data());
+        }
+
+        for (int y = firstRow; y < rowEnd; ++y, out += m_filteredRowBytes) {
+            toPngOrder(m_image, y, cur.data());
+
+            Filter best = FilterUp;
+            if (m_settings.adaptive) {
+                long bestCost = -1;
+                for (int f = FilterNone; f < FilterCount; ++f) {
+                    filterRow(static_cast<Filter>(f), cur.data(), prev.data(), m_rowBytes, m_bpp, candidate.data());
+                    long cost = filterCost(candidate.data(), m_rowBytes);
+                    if (bestCost < 0 || cost < bestCost) {
+                        bestCost = cost;
+                        best = static_cast<Filter>(f);
+                    }
+                }
+            }
+            out[0] = static_cast<uchar>(best);
+            filterRow(best, cur.data(), prev.data(), m_rowBytes, m_bpp, out + 1);
+            std::swap(prev, cur);
+        }
+    }
+
+    const cv::Mat& m_image;
+    Settings m_settings;
+    int m_stripeRows;
+    int m_bpp;
+    int m_rowBytes;
+    size_t m_filteredRowBytes;
+};
+
+// Encodes stripes on a pool, then hands the file out in order
+bool encodePng(const cv::Mat& image, PngWriter::Preset preset, int threadCount, int stripeBytes,
+               const PngWriter::ProgressCallback& progress,
+               const std::function<bool(const uchar*, size_t)>& sink) {
+    if (image.empty() || image.depth() != CV_8U) return false;
+    int channels = image.channels();
+    if (channels != 1 && channels != 3 && channels != 4) return false;
+
+    size_t filteredRowBytes = static_cast<size_t>(image.cols) * channels + 1;
+    int stripeRows = static_cast<int>(std::max<size_t>(1, stripeBytes / filteredRowBytes));
+    StripeEncoder encoder(image, settingsFor(preset), stripeRows);
+
+    std::vector<Stripe> stripes(encoder.stripeCount());
+    std::atomic<int> nextStripe{0};
+    std::mutex progressMutex;
+    int stripesDone = 0;
+    int lastPercent = -1;
+    auto worker = [&]() {
+        int index;
+        while ((index = nextStripe.fetch_add(1)) < static_cast<int>(stripes.size())) {
+            stripes[index] = encoder.encode(index);
+            if (progress) {
+                std::lock_guard<std::mutex> lock(progressMutex);
+                int percent = static_cast<int>(++stripesDone * 100 / stripes.size());
+                if (percent != lastPercent) {
+                    lastPercent = percent;
+                    progress(percent);
+                }
+            }
+        }
+    };
+
+    int threads = threadCount > 0 ? threadCount : QThread::idealThreadCount();
+    threads = std::clamp(threads, 1, static_cast<int>(stripes.size()));
+    std::vector<std::thread> pool;
+    for (int i = 1; i < threads; ++i) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : pool) {
+        thread.join();
+    }
+
+    uLong adler = 1L;
+    for (const Stripe& stripe : stripes) {
+        if (!stripe.ok) return false;
+        adler = adler32_combine(adler, stripe.adler, static_cast<z_off_t>(stripe.length));
+    }
+
+    static const uchar signature[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+    static const uchar colorTypes[5] = {0, 0, 0, 2, 6};
+    uchar ihdr[13];
+    putU32(ihdr, static_cast<uint32_t>(image.cols));
+    putU32(ihdr + 4, static_cast<uint32_t>(image.rows));
+    ihdr[8] = 8;                                    // Bit depth
+    ihdr[9] = colorTypes[channels];
+    ihdr[10] = 0;                                   // Deflate
+    ihdr[11] = 0;                                   // Adaptive filtering
+    ihdr[12] = 0;                                   // Not interlaced
+
+    // Adler-32 trailer goes in its own IDAT - the zlib stream may span any number of chunks
+    uchar trailer[4];
+    putU32(trailer, static_cast<uint32_t>(adler));
+
+    std::vector<uchar> header = makeChunk("IHDR", ihdr, sizeof(ihdr));
+    std::vector<uchar> adlerChunk = makeChunk("IDAT", trailer, sizeof(trailer));
+    std::vector<uchar> end = makeChunk("IEND", nullptr, 0);
+
+    if (!sink(signature, sizeof(signature)) || !sink(header.data(), header.size())) return false;
+    for (Stripe& stripe : stripes) {
+        if (!sink(stripe.chunk.data(), stripe.chunk.size())) return false;
+        std::vector<uchar>().swap(stripe.chunk);    // Release as we go
+    }
+    return sink(adlerChunk.data(), adlerChunk.size()) && sink(end.data(), end.size());
+}
+
+} // namespace
+
+PngWriter::PngWriter(Preset preset)
+    : m_preset(preset)
+{
+}
+
+bool PngWriter::encode(const cv::Mat& image, std::vector<uchar>& out) const {
+    out.clear();
+    auto append = [&out](const uchar* data, size_t size) {
+        out.insert(out.end(), data, data + size);
+        return true;
+    };
+    return encodePng(image, m_preset, m_threads, STRIPE_BYTES, m_progressCallback, append);
+}
+
+bool PngWriter::write(const QString& path, const cv::Mat& image) const {
+    // Streamed into a temporary file that only replaces the target on success
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+
+    auto append = [&file](const uchar* data, size_t size) {
+        return file.write(reinterpret_cast<const char*>(data), static_cast<qint64>(size)) ==
+               static_cast<qint64>(size);
+    };
+    if (!encodePng(image, m_preset, m_threads, STRIPE_BYTES, m_progressCallback, append)) {
+        file.cancelWriting();
+        return false;
+    }
+    return file.commit();
+}
+
+bool PngWriter::presetFromName(const QString& name, Preset& preset) {
+    for (Preset candidate : {Fast, Balanced, Small}) {
+        if (presetName(candidate) == name) {
+            preset = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+QString PngWriter::presetName(Preset preset) {
+    switch (preset) {
+        case Fast: return "fast";
+        case Balanced: return "balanced";
+        case Small: return "small";
+    }
+    return "";
+}
@@ -0,0 +1,211 @@
+#include "QoiCodec.h"
+#include <cstring>
+
+namespace {
+
+constexpr uchar OP_INDEX = 0x00;   // 00xxxxxx
+constexpr uchar OP_DIFF = 0x40;    // 01xxxxxx
+constexpr uchar OP_LUMA = 0x80;    // 10xxxxxx
+constexpr uchar OP_RUN = 0xc0;     // 11xxxxxx
+constexpr uchar OP_RGB = 0xfe;
+constexpr uchar OP_RGBA = 0xff;
+constexpr uchar MASK_2 = 0xc0;
+constexpr int MAX_RUN = 62;
+constexpr uchar END_MARKER[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+
+struct Rgba {
+    uchar r = 0;
+    uchar g = 0;
+    uchar b = 0;
+    uchar a = 255;
+
+    bool operator==(const Rgba& other) const {
+        return r == other.r && g == other.g && b == other.b && a == other.a;
+    }
+};
+
+inline int hashIndex(const Rgba& px) {
+    return (px.r * 3 + px.g * 5 + px.b * 7 + px.a * 11) % 64;
+}
+
+void putU32(uchar* out, uint32_t value) {
+    out[0] = static_cast<uchar>(value >> 24);
+    out[1] = static_cast<uchar>(value >> 16);
+    out[2] = static_cast<uchar>(value >> 8);
+    out[3] = static_cast<uchar>(value);
+}
+
+uint32_t getU32(const uchar* in) {
+    return (static_cast<uint32_t>(in[0]) << 24) | (static_cast<uint32_t>(in[1]) << 16) |
+           (static_cast<uint32_t>(in[2]) << 8) | static_cast<uint32_t>(in[3]);
+}
+
+} // namespace
+
+bool QoiCodec::isQoi(const uchar* data, size_t size) {
+    return size >= static_cast<size_t>(HEADER_SIZE + PADDING_SIZE) && std::memcmp(data, "qoif", 4) == 0;
+}
+
+bool QoiCodec::encode(const cv::Mat& image, std::vector<uchar>& out) {
+    out.clear();
+    if (image.empty() || image.depth() != CV_8U) return false;
+    if (static_cast<size_t>(image.cols) * image.rows > MAX_PIXELS) return false;
+
+    cv::Mat source = image;
+    if (image.channels() == 1) {
+        cv::cvtColor(image, source, cv::COLOR_GRAY2BGR);
+    } else if (image.channels() != 3 && image.channels() != 4) {
+        return false;
+    }
+    int channels = source.channels();
+
+    // Worst case is a tagged literal per pixel
+    out.resize(HEADER_SIZE + static_cast<size_t>(source.cols) * source.rows * (channels + 1) + PADDING_SIZE);
+    uchar* dst = out.data();
+
+    std::memcpy(dst, "qoif", 4);
+    putU32(dst + 4, static_cast<uint32_t>(source.cols));
+    putU32(dst + 8, static_cast<uint32_t>(source.rows));
+    dst[12] = static_cast<uchar>(channels);
+    dst[13] = 0;                                    // sRGB with linear alpha
+    dst += HEADER_SIZE;
+
+    Rgba index[64] = {};
+    for (Rgba& entry : index) entry.a = 0;
+    Rgba prev;
+    int run = 0;
+
+    for (int y = 0; y < source.rows; ++y) {
+        const uchar* row = source.ptr<uchar>(y);
+        bool lastRow = y == source.rows - 1;
+        for (int x = 0; x < source.cols; ++x, row += channels) {
+            Rgba px;
+            px.b = row[0];
+            px.g = row[1];
+            px.r = row[2];
+            px.a = channels == 4 ? row[3] : 255;
+
+            if (px == prev) {
+                run++;
+                if (run == MAX_RUN || (lastRow && x == source.cols - 1)) {
+                    *dst++ = static_cast<uchar>(OP_RUN | (run - 1));
+                    run = 0;
+                }
+                continue;
+            }
+
+            if (run > 0) {
+                *dst++ = static_cast<uchar>(OP_RUN | (run - 1));
+                run = 0;
+            }
+
+            int slot = hashIndex(px);
+            if (index[slot] == px) {
+                *dst++ = static_cast<uchar>(OP_INDEX | slot);
+            } else {
+                index[slot] = px;
+                if (px.a == prev.a) {
+                    signed char vr = static_cast<signed char>(px.r - prev.r);
+                    signed char vg = static_cast<signed char>(px.g - prev.g);
+                    signed char vb = static_cast<signed char>(px.b - prev.b);
+                    int vgR = vr - vg;
+                    int vgB = vb - vg;
+
+                    if (vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2) {
+                        *dst++ = static_cast<uchar>(OP_DIFF | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2));
+                    } else if (vgR > -9 && vgR < 8 && vg > -33 && vg < 32 && vgB > -9 && vgB < 8) {
+                        *dst++ = static_cast<uchar>(OP_LUMA | (vg + 32));
+                        *dst++ = static_cast<uchar>((vgR + 8) << 4 | (vgB + 8));
+                    } else {
+                        *dst++ = OP_RGB;
+                        *dst++ = px.r;
+                        *dst++ = px.g;
+                        *dst++ = px.b;
+                    }
+                } else {
+                    *dst++ = OP_RGBA;
+                    *dst++ = px.r;
+                    *dst++ = px.g;
+                    *dst++ = px.b;
+                    *dst++ = px.a;
+                }
+            }
+            prev = px;
+        }
+    }
+
+    std::memcpy(dst, END_MARKER, PADDING_SIZE);
+    dst += PADDING_SIZE;
+    out.resize(dst - out.data());
+    return true;
+}
+
+cv::Mat QoiCodec::decode(const uchar* data, size_t size) {
+    if (!isQoi(data, size)) return cv::Mat();
+
+    uint32_t width = getU32(data + 4);
+    uint32_t height = getU32(data + 8);
+    int channels = data[12];
+    if (width == 0 || height == 0 || (channels != 3 && channels != 4) ||
+        height >= MAX_PIXELS / width) {
+        return cv::Mat();
+    }
+
+    cv::Mat image(static_cast<int>(height), static_cast<int>(width), channels == 4 ? CV_8UC4 : CV_8UC3);
+    const uchar* src = data + HEADER_SIZE;
+    const uchar* end = data + size - PADDING_SIZE;  // Ops never read into the end marker
+
+    Rgba index[64] = {};
+    for (Rgba& entry : index) entry.a = 0;
+    Rgba px;
+    int run = 0;
+
+    for (int y = 0; y < image.rows; ++y) {
+        uchar* row = image.ptr<uchar>(y);
+        for (int x = 0; x < image.cols; ++x, row += channels) {
+            if (run > 0) {
+                run--;
+            } else if (src < end) {
+                uchar op = *src++;
+                if (op == OP_RGB) {
+                    if (end - src < 3) return cv::Mat();
+                    px.r = src[0];
+                    px.g = src[1];
+                    px.b = src[2];
+                    src += 3;
+                } else if (op == OP_RGBA) {
+                    if (end - src < 4) return cv::Mat();
+                    px.r = src[0];
+                    px.g = src[1];
+                    px.b = src[2];
+                    px.a = src[3];
+                    src += 4;
+                } else if ((op & MASK_2) == OP_INDEX) {
+                    px = index[op];
+                } else if ((op & MASK_2) == OP_DIFF) {
+                    px.r = static_cast<uchar>(px.r + ((op >> 4) & 0x03) - 2);
+                    px.g = static_cast<uchar>(px.g + ((op >> 2) & 0x03) - 2);
+                    px.b = static_cast<uchar>(px.b + (op & 0x03) - 2);
+                } else if ((op & MASK_2) == OP_LUMA) {
+                    if (src >= end) return cv::Mat();
+                    uchar next = *src++;
+                    int vg = (op & 0x3f) - 32;
+                    px.r = static_cast<uchar>(px.r + vg - 8 + ((next >> 4) & 0x0f));
+                    px.g = static_cast<uchar>(px.g + vg);
+                    px.b = static_cast<uchar>(px.b + vg - 8 + (next & 0x0f));
+                } else {
+                    run = op & 0x3f;
+                }
+                index[hashIndex(px)] = px;
+            } else {
+                return cv::Mat();  // Truncated
+            }
+
+            row[0] = px.b;
+            row[1] = px.g;
+            row[2] = px.r;
+            if (channels == 4) row[3] = px.a;
+        }
+    }
+    return image;
+}
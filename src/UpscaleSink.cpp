@@ -0,0 +1,68 @@
+#include "UpscaleSink.h"
+#include <QDebug>
+
+bool MatUpscaleSink::begin(int width, int height, int type) {
+    m_image.create(height, width, type);
+    return !m_image.empty();
+}
+
+cv::Mat MatUpscaleSink::bandBuffer(int y, int rows) {
+    return m_image.rowRange(y, y + rows);
+}
+
+bool MatUpscaleSink::commitBand(int y, int rows) {
+    Q_UNUSED(y);
+    Q_UNUSED(rows);
+    return true;
+}
+
+bool MatUpscaleSink::finish() {
+    return true;
+}
+
+MappedFileUpscaleSink::MappedFileUpscaleSink(const QString& path)
+    : m_file(path)
+{
+}
+
+MappedFileUpscaleSink::~MappedFileUpscaleSink() {
+    m_image = cv::Mat();
+    if (m_mapped) {
+        m_file.unmap(m_mapped);
+    }
+    m_file.close();
+}
+
+bool MappedFileUpscaleSink::begin(int width, int height, int type) {
+    qint64 rowBytes = static_cast<qint64>(width) * CV_ELEM_SIZE(type);
+    qint64 totalBytes = rowBytes * height;
+    
+    if (!m_file.open(QIODevice::ReadWrite | QIODevice::Truncate) || !m_file.resize(totalBytes)) {
+        qDebug() << "Cannot create upscale output file:" << m_file.errorString();
+        return false;
+    }
+    
+    m_mapped = m_file.map(0, totalBytes);
+    if (!m_mapped) {
+        qDebug() << "Cannot map upscale output file:" << m_file.errorString();
+        return false;
+    }
+    
+    m_image = cv::Mat(height, width, type, m_mapped, static_cast<size_t>(rowBytes));
+    return true;
+}
+
+cv::Mat MappedFileUpscaleSink::bandBuffer(int y, int rows) {
+    return m_image.rowRange(y, y + rows);
+}
+
+bool MappedFileUpscaleSink::commitBand(int y, int rows) {
+    // Finished rows are left to the OS to write back
+    Q_UNUSED(y);
+    Q_UNUSED(rows);
+    return true;
+}
+
+bool MappedFileUpscaleSink::finish() {
+    return m_mapped != nullptr;
+}
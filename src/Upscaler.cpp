@@ -1,12 +1,38 @@
 #include "Upscaler.h"
+#include "UpscaleSink.h"
 #include <QDir>
 #include <QStandardPaths>
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
 #include <QFile>
 #include <QEventLoop>
+#include <QFileInfo>
+#include <QTimer>
 #include <QDebug>
+#include <QCryptographicHash>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSysInfo>
 #include <onnxruntime_cxx_api.h>
+#include <opencv2/core/hal/intrin.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <iterator>
+#include <thread>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <unistd.h>
+#endif
 
 /*
  * Real-ESRGAN ONNX Upscaler
@@ -20,16 +46,203 @@
  * - RealESRGAN_x4_anime: 4x upscaling, optimized for anime/illustrations
  */
 
+namespace {
+
+// One ORT environment for the whole process - sessions share its thread pools and logger
+std::shared_ptr<Ort::Env> sharedOrtEnv() {
+    // Use ERROR level to suppress all those schema warnings
+    static std::shared_ptr<Ort::Env> env =
+        std::make_shared<Ort::Env>(ORT_LOGGING_LEVEL_ERROR, "RealESRGAN");
+    return env;
+}
+
+std::basic_string<ORTCHAR_T> toOrtPath(const QString& path) {
+#ifdef _WIN32
+    return path.toStdWString();
+#else
+    return path.toStdString();
+#endif
+}
+
+// Physical memory currently free, used to size tile batches
+size_t availableMemoryBytes() {
+#ifdef _WIN32
+    MEMORYSTATUSEX status;
+    status.dwLength = sizeof(status);
+    if (GlobalMemoryStatusEx(&status)) {
+        return static_cast<size_t>(status.ullAvailPhys);
+    }
+#elif defined(__linux__)
+    long pages = sysconf(_SC_AVPHYS_PAGES);
+    long pageSize = sysconf(_SC_PAGESIZE);
+    if (pages > 0 && pageSize > 0) {
+        return static_cast<size_t>(pages) * static_cast<size_t>(pageSize);
+    }
+#endif
+    return size_t(2) * 1024 * 1024 * 1024;  // Conservative default
+}
+
+// Installed physical memory, part of the tile calibration key
+size_t totalMemoryBytes() {
+#ifdef _WIN32
+    MEMORYSTATUSEX status;
+    status.dwLength = sizeof(status);
+    if (GlobalMemoryStatusEx(&status)) {
+        return static_cast<size_t>(status.ullTotalPhys);
+    }
+#elif defined(__linux__)
+    long pages = sysconf(_SC_PHYS_PAGES);
+    long pageSize = sysconf(_SC_PAGESIZE);
+    if (pages > 0 && pageSize > 0) {
+        return static_cast<size_t>(pages) * static_cast<size_t>(pageSize);
+    }
+#endif
+    return 0;
+}
+
+#if CV_SIMD128
+inline void storeNormalized(const cv::v_uint8x16& v, float* dst, const cv::v_float32x4& scale) {
+    cv::v_uint16x8 lo, hi;
+    cv::v_expand(v, lo, hi);
+    cv::v_uint32x4 a, b, c, d;
+    cv::v_expand(lo, a, b);
+    cv::v_expand(hi, c, d);
+    cv::v_store(dst,      cv::v_cvt_f32(cv::v_reinterpret_as_s32(a)) * scale);
+    cv::v_store(dst + 4,  cv::v_cvt_f32(cv::v_reinterpret_as_s32(b)) * scale);
+    cv::v_store(dst + 8,  cv::v_cvt_f32(cv::v_reinterpret_as_s32(c)) * scale);
+    cv::v_store(dst + 12, cv::v_cvt_f32(cv::v_reinterpret_as_s32(d)) * scale);
+}
+
+// Saturating packs clamp to [0, 255], so [0, 1] clipping comes for free
+inline cv::v_uint8x16 loadScaledU8(const float* src, const cv::v_float32x4& scale) {
+    cv::v_int32x4 a = cv::v_round(cv::v_load(src) * scale);
+    cv::v_int32x4 b = cv::v_round(cv::v_load(src + 4) * scale);
+    cv::v_int32x4 c = cv::v_round(cv::v_load(src + 8) * scale);
+    cv::v_int32x4 d = cv::v_round(cv::v_load(src + 12) * scale);
+    return cv::v_pack_u(cv::v_pack(a, b), cv::v_pack(c, d));
+}
+#endif
+
+// u8 BGR/BGRA pixels -> normalised planar RGB floats, in one pass.
+// Single-channel input (alpha) is replicated into all three planes.
+void packBgrToPlanarRgb(const uchar* src, int channels, int count, float* r, float* g, float* b) {
+    const float norm = 1.0f / 255.0f;
+    int x = 0;
+#if CV_SIMD128
+    const cv::v_float32x4 vNorm = cv::v_setall_f32(norm);
+    for (; x <= count - 16; x += 16) {
+        cv::v_uint8x16 vb, vg, vr, va;
+        if (channels == 4) {
+            cv::v_load_deinterleave(src + x * 4, vb, vg, vr, va);
+        } else if (channels == 3) {
+            cv::v_load_deinterleave(src + x * 3, vb, vg, vr);
+        } else {
+            vb = vg = vr = cv::v_load(src + x);
+        }
+        storeNormalized(vr, r + x, vNorm);
+        storeNormalized(vg, g + x, vNorm);
+        storeNormalized(vb, b + x, vNorm);
+    }
+#endif
+    const int last = channels >= 3 ? 2 : 0;
+    for (; x < count; ++x) {
+        const uchar* px = src + x * channels;
+        r[x] = px[last] * norm;
+        g[x] = px[last / 2] * norm;
+        b[x] = px[0] * norm;
+    }
+}
+
+// He et al. guided filter: smooths `src` while following edges in `guide`
+cv::Mat guidedFilter(const cv::Mat& guide, const cv::Mat& src, int radius, double eps) {
+    cv::Mat p;
+    src.convertTo(p, CV_32F, 1.0 / 255.0);
+    const cv::Size window(2 * radius + 1, 2 * radius + 1);
+    
+    cv::Mat meanI, meanP, corrIP, corrII;
+    cv::boxFilter(guide, meanI, CV_32F, window);
+    cv::boxFilter(p, meanP, CV_32F, window);
+    cv::boxFilter(guide.mul(p), corrIP, CV_32F, window);
+    cv::boxFilter(guide.mul(guide), corrII, CV_32F, window);
+    
+    cv::Mat a = (corrIP - meanI.mul(meanP)) / (corrII - meanI.mul(meanI) + eps);
+    cv::Mat b = meanP - a.mul(meanI);
+    cv::boxFilter(a, a, CV_32F, window);
+    cv::boxFilter(b, b, CV_32F, window);
+    
+    cv::Mat result;
+    cv::Mat(a.mul(guide) + b).convertTo(result, CV_8U, 255.0);
+    return result;
+}
+
+// Planar RGB floats -> clamped u8 BGR pixels (BGRA when alpha is given), in one pass
+void unpackPlanarRgbToBgr(const float* r, const float* g, const float* b, const uchar* alpha,
+                          int count, uchar* dst) {
+    int x = 0;
+#if CV_SIMD128
+    const cv::v_float32x4 v255 = cv::v_setall_f32(255.0f);
+    if (alpha) {
+        for (; x <= count - 16; x += 16) {
+            cv::v_store_interleave(dst + x * 4,
+                                   loadScaledU8(b + x, v255),
+                                   loadScaledU8(g + x, v255),
+                                   loadScaledU8(r + x, v255),
+                                   cv::v_load(alpha + x));
+        }
+    } else {
+        for (; x <= count - 16; x += 16) {
+            cv::v_store_interleave(dst + x * 3,
+                                   loadScaledU8(b + x, v255),
+                                   loadScaledU8(g + x, v255),
+                                   loadScaledU8(r + x, v255));
+        }
+    }
+#endif
+    const int channels = alpha ? 4 : 3;
+    for (; x < count; ++x) {
+        uchar* px = dst + x * channels;
+        px[0] = cv::saturate_cast<uchar>(b[x] * 255.0f);
+        px[1] = cv::saturate_cast<uchar>(g[x] * 255.0f);
+        px[2] = cv::saturate_cast<uchar>(r[x] * 255.0f);
+        if (alpha) px[3] = alpha[x];
+    }
+}
+
+// dst[x] += src[x] * colWeights[x] * rowWeight
+void accumulateWeighted(const float* src, const float* colWeights, float rowWeight, int count, float* dst) {
+    int x = 0;
+#if CV_SIMD128
+    const cv::v_float32x4 vRow = cv::v_setall_f32(rowWeight);
+    for (; x <= count - 4; x += 4) {
+        cv::v_float32x4 w = cv::v_load(colWeights + x) * vRow;
+        cv::v_store(dst + x, cv::v_muladd(cv::v_load(src + x), w, cv::v_load(dst + x)));
+    }
+#endif
+    for (; x < count; ++x) {
+        dst[x] += src[x] * colWeights[x] * rowWeight;
+    }
+}
+
+} // namespace
+
 Upscaler::Upscaler(QObject* parent)
     : QObject(parent)
+    , m_idleTimer(new QTimer(this))
 {
+    m_idleTimer->setSingleShot(true);
+    m_idleTimer->setInterval(DEFAULT_IDLE_TIMEOUT_MS);
+    connect(m_idleTimer, &QTimer::timeout, this, [this]() {
+        if (m_activeJobs.load() == 0) {
+            unloadModel();
+        }
+    });
 }
 
 Upscaler::~Upscaler() {
     unloadModel();
 }
 
-QString Upscaler::getModelPath(Model model) {
+QString Upscaler::getModelPath(Model model, Precision precision) {
     QString appData = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
     QDir dir(appData + "/models");
     if (!dir.exists()) {
@@ -47,9 +260,97 @@ QString Upscaler::getModelPath(Model model) {
             break;
     }
     
+    // Reduced-precision variants sit next to the FP32 download, e.g. real_esrgan_x4.int8.onnx
+    switch (precision) {
+        case PrecisionFP16:
+            filename.replace(".onnx", ".fp16.onnx");
+            break;
+        case PrecisionINT8:
+            filename.replace(".onnx", ".int8.onnx");
+            break;
+        default:
+            break;
+    }
+    
     return dir.filePath(filename);
 }
 
+QString Upscaler::getOptimizedModelPath(const QString& modelPath) {
+    QFileInfo fi(modelPath);
+    return fi.absolutePath() + "/" + fi.completeBaseName() + ".optimized.onnx";
+}
+
+QString Upscaler::getPrecisionReportPath(Model model) {
+    QFileInfo fi(getModelPath(model));
+    return fi.absolutePath() + "/" + fi.completeBaseName() + ".precision.json";
+}
+
+bool Upscaler::isVariantAvailable(Model model, Precision precision) {
+    return QFile::exists(getModelPath(model, precision));
+}
+
+void Upscaler::setPrecision(Precision precision) {
+    m_precision = precision;
+}
+
+Upscaler::Precision Upscaler::resolvePrecision(Model model) {
+    if (m_precision != PrecisionAuto) return m_precision;
+    
+    // Lossy variants are only used once a benchmark report (pixeleraser-cli
+    // --precision-report) shows them fast and close enough to FP32. A report
+    // older than the variant file measured different weights.
+    QJsonObject report;
+    QString reportPath = getPrecisionReportPath(model);
+    QFile reportFile(reportPath);
+    if (reportFile.open(QIODevice::ReadOnly)) {
+        report = QJsonDocument::fromJson(reportFile.readAll()).object();
+    }
+    auto acceptable = [&](Precision precision) {
+        if (!isVariantAvailable(model, precision)) return false;
+        QJsonObject entry = report.value(getPrecisionName(precision)).toObject();
+        if (entry.isEmpty()) return false;
+        if (QFileInfo(reportPath).lastModified() < QFileInfo(getModelPath(model, precision)).lastModified()) {
+            return false;
+        }
+        PrecisionReport measured;
+        measured.precision = precision;
+        measured.speedup = entry.value("speedup").toDouble();
+        measured.psnr = entry.value("psnr").toDouble();
+        return passesPrecisionReport(measured);
+    };
+    
+    // VNNI turns INT8 convolutions into single dot-product instructions
+    bool vnni = cv::checkHardwareSupport(CV_CPU_AVX_512VNNI);
+#ifdef CV_CPU_NEON_DOTPROD
+    vnni = vnni || cv::checkHardwareSupport(CV_CPU_NEON_DOTPROD);
+#endif
+    if (vnni && acceptable(PrecisionINT8)) return PrecisionINT8;
+    
+    // Halved weight traffic pays off when wide vectors make the convolutions memory-bound
+    if (cv::checkHardwareSupport(CV_CPU_AVX_512F) && acceptable(PrecisionFP16)) return PrecisionFP16;
+    
+    return PrecisionFP32;
+}
+
+bool Upscaler::passesPrecisionReport(const PrecisionReport& report) {
+    if (report.precision == PrecisionFP32) return true;
+    return report.psnr >= MIN_VARIANT_PSNR && report.speedup > 1.0;
+}
+
+QString Upscaler::getPrecisionName(Precision precision) {
+    switch (precision) {
+        case PrecisionAuto:
+            return "Auto";
+        case PrecisionFP32:
+            return "FP32";
+        case PrecisionFP16:
+            return "FP16";
+        case PrecisionINT8:
+            return "INT8";
+    }
+    return "";
+}
+
 bool Upscaler::isModelAvailable(Model model) {
     return QFile::exists(getModelPath(model));
 }
@@ -157,51 +458,198 @@ struct Upscaler::OnnxSession {
     std::vector<std::string> outputNameStrings;
     std::vector<const char*> inputNames;
     std::vector<const char*> outputNames;
+    bool dynamicBatch = false;                 // Input dim 0 is symbolic - [N,3,H,W] accepted
+    std::atomic<int> batchCheck{BatchUnchecked};
     
-    OnnxSession() {
-        // Use ERROR level to suppress all those schema warnings
-        env = std::make_shared<Ort::Env>(ORT_LOGGING_LEVEL_ERROR, "RealESRGAN");
-        sessionOptions.SetIntraOpNumThreads(4);
+    explicit OnnxSession(int intraOpThreads) {
+        env = sharedOrtEnv();
+        sessionOptions.SetIntraOpNumThreads(intraOpThreads);
         sessionOptions.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_ALL);
     }
 };
 
-bool Upscaler::loadModel(Model model) {
-    QString modelPath = getModelPath(model);
+// Sessions for one model file, all created with the same intra-op thread count
+struct Upscaler::SessionPool {
+    QString modelPath;
+    int intraOpThreads = 0;
+    std::vector<std::shared_ptr<OnnxSession>> sessions;
+};
+
+void Upscaler::setIdleTimeout(int msec) {
+    m_idleTimer->setInterval(msec);
+    if (msec <= 0) {
+        m_idleTimer->stop();
+    }
+}
+
+void Upscaler::setOptimizedModelCacheEnabled(bool enabled) {
+    m_optimizedCacheEnabled = enabled;
+}
+
+void Upscaler::setMaxConcurrentTiles(int count) {
+    m_maxConcurrentTiles = std::max(0, count);
+}
+
+void Upscaler::setMaxBatchSize(int count) {
+    m_maxBatchSize = std::max(0, count);
+}
+
+void Upscaler::setTileOverlap(int pixels) {
+    m_tileOverlap = std::max(0, pixels);
+}
+
+void Upscaler::setAlphaMode(AlphaMode mode) {
+    m_alphaMode = mode;
+}
+
+void Upscaler::setTilePreviewEnabled(bool enabled) {
+    m_previewEnabled = enabled;
+}
+
+void Upscaler::setRunObserver(std::function<void(bool running)> observer) {
+    m_runObserver = std::move(observer);
+}
+
+void Upscaler::cancel() {
+    m_cancelRequested = true;
+    
+    // Runs already inside ORT bail out at the next kernel boundary
+    std::lock_guard<std::mutex> lock(m_activeRunMutex);
+    for (TileBuffers* buffers : m_activeRuns) {
+        buffers->runOptions.SetTerminate();
+    }
+}
+
+void Upscaler::setTileSize(int pixels) {
+    // Even, so two quadrants of tileSize / 2 exactly tile a whole tile
+    pixels = std::max(0, pixels);
+    m_tileSizeOverride = pixels + pixels % 2;
+}
+
+void Upscaler::clearTileCalibration() {
+    std::lock_guard<std::mutex> lock(m_calibrationMutex);
+    m_calibratedTileSizes.clear();
+    QFile::remove(getCalibrationPath());
+}
+
+Upscaler::UpscaleStats Upscaler::lastStats() const {
+    std::lock_guard<std::mutex> lock(m_statsMutex);
+    return m_lastStats;
+}
+
+Upscaler::ThreadPlan Upscaler::planThreads(int tileCount) const {
+    int cores = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    
+    // Conv kernels stop scaling after a handful of threads, so spread the cores
+    // over several concurrent tiles instead of feeding one tile all of them
+    int workers = m_maxConcurrentTiles > 0
+        ? m_maxConcurrentTiles
+        : std::max(1, cores / TARGET_INTRA_OP_THREADS);
+    workers = std::min(workers, cores);
+    
+    ThreadPlan plan;
+    // Intra-op threads depend only on the machine so the session pool stays reusable
+    plan.intraOpThreads = std::max(1, cores / workers);
+    plan.concurrency = std::clamp(tileCount, 1, workers);
+    return plan;
+}
+
+std::vector<std::shared_ptr<Upscaler::OnnxSession>> Upscaler::acquireSessions(const QString& modelPath, const ThreadPlan& plan) {
+    const QString& key = modelPath;
+    std::vector<std::shared_ptr<OnnxSession>> sessions;
     
+    {
+        std::lock_guard<std::mutex> lock(m_sessionMutex);
+        for (auto it = m_sessionPools.begin(); it != m_sessionPools.end(); ++it) {
+            if (it->modelPath == key) {
+                if (it->intraOpThreads == plan.intraOpThreads) {
+                    sessions = it->sessions;
+                    qDebug() << "Reusing" << sessions.size() << "cached session(s) for" << key;
+                }
+                m_sessionPools.erase(it);  // Re-inserted at the front below
+                break;
+            }
+        }
+    }
+    
+    // Load missing sessions outside the lock - parsing and optimising the graph takes seconds
+    while (static_cast<int>(sessions.size()) < plan.concurrency) {
+        std::shared_ptr<OnnxSession> session = createSession(modelPath, plan.intraOpThreads);
+        if (!session) break;  // Run with what we have
+        sessions.push_back(std::move(session));
+    }
+    if (sessions.empty()) return {};
+    
+    {
+        std::lock_guard<std::mutex> lock(m_sessionMutex);
+        m_sessionPools.push_front({key, plan.intraOpThreads, sessions});
+        while (m_sessionPools.size() > MAX_CACHED_MODELS) {
+            m_sessionPools.pop_back();  // In-flight upscales keep their own references
+        }
+    }
+    
+    sessions.resize(std::min(sessions.size(), static_cast<size_t>(plan.concurrency)));
+    return sessions;
+}
+
+std::shared_ptr<Upscaler::OnnxSession> Upscaler::createSession(const QString& modelPath, int intraOpThreads) {
     if (!QFile::exists(modelPath)) {
         emit error("Model file not found: " + modelPath);
-        return false;
+        return nullptr;
     }
     
-    qDebug() << "Loading ONNX model from:" << modelPath;
+    // A previously serialised optimised graph skips parsing + graph optimisation.
+    // Ignore it if the source model was re-downloaded after it was written.
+    QString optimizedPath = getOptimizedModelPath(modelPath);
+    QFileInfo optimizedInfo(optimizedPath);
+    bool useOptimized = m_optimizedCacheEnabled && optimizedInfo.exists() &&
+                        optimizedInfo.lastModified() >= QFileInfo(modelPath).lastModified();
     
     try {
-        m_session = std::make_unique<OnnxSession>();
+        std::shared_ptr<OnnxSession> onnx;
+        
+        if (useOptimized) {
+            qDebug() << "Loading optimized ONNX model from:" << optimizedPath;
+            try {
+                onnx = std::make_shared<OnnxSession>(intraOpThreads);
+                onnx->sessionOptions.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_DISABLE_ALL);
+                std::basic_string<ORTCHAR_T> ortPath = toOrtPath(optimizedPath);
+                onnx->session = std::make_unique<Ort::Session>(*onnx->env, ortPath.c_str(), onnx->sessionOptions);
+            } catch (const Ort::Exception& e) {
+                qDebug() << "Optimized model unusable, rebuilding:" << e.what();
+                QFile::remove(optimizedPath);
+                onnx.reset();
+            }
+        }
         
-        // Load the model
-        std::wstring wModelPath = modelPath.toStdWString();
-        m_session->session = std::make_unique<Ort::Session>(
-            *m_session->env, 
-            wModelPath.c_str(), 
-            m_session->sessionOptions
-        );
+        if (!onnx) {
+            qDebug() << "Loading ONNX model from:" << modelPath;
+            onnx = std::make_shared<OnnxSession>(intraOpThreads);
+            
+            std::basic_string<ORTCHAR_T> ortOptimizedPath = toOrtPath(optimizedPath);
+            if (m_optimizedCacheEnabled) {
+                onnx->sessionOptions.SetOptimizedModelFilePath(ortOptimizedPath.c_str());
+            }
+            
+            std::basic_string<ORTCHAR_T> ortPath = toOrtPath(modelPath);
+            onnx->session = std::make_unique<Ort::Session>(*onnx->env, ortPath.c_str(), onnx->sessionOptions);
+        }
         
         // Get input/output info
         Ort::AllocatorWithDefaultOptions allocator;
         
         // Input info
-        size_t numInputNodes = m_session->session->GetInputCount();
+        size_t numInputNodes = onnx->session->GetInputCount();
         qDebug() << "Model has" << numInputNodes << "input(s)";
         
         if (numInputNodes > 0) {
-            auto inputName = m_session->session->GetInputNameAllocated(0, allocator);
-            m_session->inputNameStrings.push_back(std::string(inputName.get()));
-            m_session->inputNames.push_back(m_session->inputNameStrings.back().c_str());
-            qDebug() << "Input name:" << m_session->inputNameStrings[0].c_str();
+            auto inputName = onnx->session->GetInputNameAllocated(0, allocator);
+            onnx->inputNameStrings.push_back(std::string(inputName.get()));
+            onnx->inputNames.push_back(onnx->inputNameStrings.back().c_str());
+            qDebug() << "Input name:" << onnx->inputNameStrings[0].c_str();
             
             // Get input shape info
-            auto inputTypeInfo = m_session->session->GetInputTypeInfo(0);
+            auto inputTypeInfo = onnx->session->GetInputTypeInfo(0);
             auto tensorInfo = inputTypeInfo.GetTensorTypeAndShapeInfo();
             auto inputShape = tensorInfo.GetShape();
             qDebug() << "Expected input shape:";
@@ -209,20 +657,26 @@ bool Upscaler::loadModel(Model model) {
                 qDebug() << "  Dim" << i << ":" << inputShape[i] << (inputShape[i] == -1 ? "(dynamic)" : "");
             }
             qDebug() << "Input element type:" << tensorInfo.GetElementType();
+            if (tensorInfo.GetElementType() != ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT) {
+                // Quantised/FP16 variants must keep float32 I/O to share the tile path
+                emit error("Model must take float32 input: " + modelPath);
+                return nullptr;
+            }
+            onnx->dynamicBatch = !inputShape.empty() && inputShape[0] < 0;
         }
         
         // Output info
-        size_t numOutputNodes = m_session->session->GetOutputCount();
+        size_t numOutputNodes = onnx->session->GetOutputCount();
         qDebug() << "Model has" << numOutputNodes << "output(s)";
         
         if (numOutputNodes > 0) {
-            auto outputName = m_session->session->GetOutputNameAllocated(0, allocator);
-            m_session->outputNameStrings.push_back(std::string(outputName.get()));
-            m_session->outputNames.push_back(m_session->outputNameStrings.back().c_str());
-            qDebug() << "Output name:" << m_session->outputNameStrings[0].c_str();
+            auto outputName = onnx->session->GetOutputNameAllocated(0, allocator);
+            onnx->outputNameStrings.push_back(std::string(outputName.get()));
+            onnx->outputNames.push_back(onnx->outputNameStrings.back().c_str());
+            qDebug() << "Output name:" << onnx->outputNameStrings[0].c_str();
             
             // Get output shape info
-            auto outputTypeInfo = m_session->session->GetOutputTypeInfo(0);
+            auto outputTypeInfo = onnx->session->GetOutputTypeInfo(0);
             auto tensorInfo = outputTypeInfo.GetTensorTypeAndShapeInfo();
             auto outputShape = tensorInfo.GetShape();
             qDebug() << "Expected output shape:";
@@ -231,30 +685,645 @@ bool Upscaler::loadModel(Model model) {
             }
         }
         
-        m_currentModel = model;
         qDebug() << "Model loaded successfully!";
-        return true;
+        return onnx;
         
     } catch (const Ort::Exception& e) {
         QString msg = QString("ONNX Runtime error: %1").arg(e.what());
         qDebug() << msg;
         emit error(msg);
-        m_session.reset();
-        return false;
+        return nullptr;
     } catch (const std::exception& e) {
         QString msg = QString("Error loading model: %1").arg(e.what());
         qDebug() << msg;
         emit error(msg);
-        m_session.reset();
-        return false;
+        return nullptr;
     }
 }
 
 void Upscaler::unloadModel() {
-    m_session.reset();
+    std::lock_guard<std::mutex> lock(m_sessionMutex);
+    if (!m_sessionPools.empty()) {
+        qDebug() << "Releasing cached upscaler sessions for" << m_sessionPools.size() << "model(s)";
+    }
+    m_sessionPools.clear();
+}
+
+void Upscaler::scheduleIdleRelease() {
+    // upscale() runs on a worker thread - restart the timer on the owning thread
+    QMetaObject::invokeMethod(this, [this]() {
+        if (m_idleTimer->interval() > 0) {
+            m_idleTimer->start();
+        }
+    }, Qt::QueuedConnection);
+}
+
+size_t Upscaler::tileWorkingSetBytes(cv::Size tensorSize, int scale) {
+    // Rough working set of one tile: input + output planes plus the RRDB feature
+    // maps at input resolution and the 64-channel upsampling stages
+    size_t pixels = static_cast<size_t>(tensorSize.width) * tensorSize.height;
+    return pixels * sizeof(float) *
+        (3 + 3 * scale * scale + FEATURE_CHANNELS * (LIVE_FEATURE_MAPS + scale * scale));
+}
+
+int Upscaler::chooseBatchSize(cv::Size tileSize, int scale, int concurrency) const {
+    if (m_maxBatchSize > 0) return m_maxBatchSize;
+    
+    // Leave half of free memory for the rest of the app, split across workers
+    size_t perTile = tileWorkingSetBytes(tileSize, scale);
+    size_t budget = availableMemoryBytes() / 2 / std::max(1, concurrency);
+    int batch = static_cast<int>(budget / std::max<size_t>(perTile, 1));
+    return std::clamp(batch, 1, MAX_BATCH_SIZE);
+}
+
+// Per-worker tensors bound once through IoBinding and reused for every batch,
+// so the steady-state tile loop allocates nothing. The storage grows to the
+// largest batch seen and every batch shape keeps its own binding over it, so a
+// band's short last batch or a quadrant batch doesn't rebind.
+struct Upscaler::TileBuffers {
+    struct Binding {
+        int batch = 0;
+        cv::Size tensorSize;
+        Ort::Value inputTensor{nullptr};
+        Ort::Value outputTensor{nullptr};
+        std::unique_ptr<Ort::IoBinding> binding;
+    };
+    
+    const OnnxSession* session = nullptr;
+    int scale = 0;
+    cv::Size tensorSize;        // Shape of the last batch
+    std::vector<float> input;
+    std::vector<float> output;
+    std::vector<int> rowIndex;  // Source row/column of every tensor row/column,
+    std::vector<int> colIndex;  // reflect padding included
+    std::vector<float> rowWeights;  // Feather ramps of the tile being blended
+    std::vector<float> colWeights;
+    cv::Mat fillStorage;        // Resized colour of transparent tiles
+    std::vector<float> fillPlanes;
+    Ort::MemoryInfo memoryInfo = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
+    std::vector<Binding> bindings;
+    Binding* current = nullptr;
+    Ort::RunOptions runOptions;
+};
+
+Upscaler::TileLayout Upscaler::makeLayout(cv::Size imageSize, int tileSize, int overlap, int scale) {
+    TileLayout layout;
+    layout.tileSize = tileSize;
+    // More than half a tile would let three tiles share one strip
+    layout.overlap = std::min(overlap, tileSize / 2);
+    layout.scale = scale;
+    
+    // Every tile is padded to the full padded tile shape (even, as pixel-shuffle
+    // requires) so the bound tensors keep one shape for the whole run
+    int fullH = std::min(imageSize.height, tileSize + 2 * layout.overlap);
+    int fullW = std::min(imageSize.width, tileSize + 2 * layout.overlap);
+    layout.tensorSize = cv::Size(fullW + (fullW % 2), fullH + (fullH % 2));
+    return layout;
+}
+
+struct Upscaler::ActiveRun {
+    Upscaler* owner;
+    TileBuffers* buffers;
+    int count;
+    
+    ActiveRun(Upscaler* owner, TileBuffers* buffers, int count = 1)
+        : owner(owner), buffers(buffers), count(count) {
+        std::lock_guard<std::mutex> lock(owner->m_activeRunMutex);
+        for (int i = 0; i < count; ++i) {
+            owner->m_activeRuns.push_back(buffers + i);
+            // A cancel that arrived before registration must still stop this run
+            if (owner->m_cancelRequested.load()) buffers[i].runOptions.SetTerminate();
+        }
+    }
+    ~ActiveRun() {
+        std::lock_guard<std::mutex> lock(owner->m_activeRunMutex);
+        auto& runs = owner->m_activeRuns;
+        runs.erase(std::remove_if(runs.begin(), runs.end(),
+                                  [this](TileBuffers* run) { return run >= buffers && run < buffers + count; }),
+                   runs.end());
+    }
+};
+
+cv::Rect Upscaler::tileRegion(cv::Point origin, cv::Size imageSize, const TileLayout& layout) {
+    int tileY = std::max(0, origin.y - layout.overlap);
+    int tileX = std::max(0, origin.x - layout.overlap);
+    int tileEndY = std::min(imageSize.height, origin.y + layout.tileSize + layout.overlap);
+    int tileEndX = std::min(imageSize.width, origin.x + layout.tileSize + layout.overlap);
+    return cv::Rect(tileX, tileY, tileEndX - tileX, tileEndY - tileY);
+}
+
+void Upscaler::bindBuffers(OnnxSession& session, TileBuffers& buffers, int batch,
+                           cv::Size tensorSize, int scale) {
+    if (buffers.session != &session || buffers.scale != scale) {
+        buffers.bindings.clear();
+        buffers.session = &session;
+        buffers.scale = scale;
+    }
+    buffers.tensorSize = tensorSize;
+    for (TileBuffers::Binding& bound : buffers.bindings) {
+        if (bound.batch == batch && bound.tensorSize == tensorSize) {
+            buffers.current = &bound;
+            return;
+        }
+    }
+    
+    const int64_t h = tensorSize.height;
+    const int64_t w = tensorSize.width;
+    const int64_t inputShape[4] = {batch, 3, h, w};
+    const int64_t outputShape[4] = {batch, 3, h * scale, w * scale};
+    const size_t inputCount = static_cast<size_t>(batch) * 3 * h * w;
+    const size_t outputCount = inputCount * scale * scale;
+    
+    // Growing the storage moves it, so the tensors bound over it go too
+    if (inputCount > buffers.input.size()) {
+        buffers.bindings.clear();
+        buffers.input.resize(inputCount);
+        buffers.output.resize(outputCount);
+    }
+    buffers.rowIndex.resize(std::max<size_t>(buffers.rowIndex.size(), tensorSize.height));
+    buffers.colIndex.resize(std::max<size_t>(buffers.colIndex.size(), tensorSize.width));
+    // Feather ramps never span more than the tensor, whichever tile they are for
+    buffers.rowWeights.reserve(static_cast<size_t>(tensorSize.height) * scale);
+    buffers.colWeights.reserve(static_cast<size_t>(tensorSize.width) * scale);
+    
+    TileBuffers::Binding bound;
+    bound.batch = batch;
+    bound.tensorSize = tensorSize;
+    bound.inputTensor = Ort::Value::CreateTensor<float>(
+        buffers.memoryInfo, buffers.input.data(), inputCount, inputShape, 4);
+    bound.outputTensor = Ort::Value::CreateTensor<float>(
+        buffers.memoryInfo, buffers.output.data(), outputCount, outputShape, 4);
+    bound.binding = std::make_unique<Ort::IoBinding>(*session.session);
+    bound.binding->BindInput(session.inputNames[0], bound.inputTensor);
+    bound.binding->BindOutput(session.outputNames[0], bound.outputTensor);
+    
+    buffers.bindings.push_back(std::move(bound));
+    buffers.current = &buffers.bindings.back();
+}
+
+void Upscaler::runBatch(OnnxSession& session, TileBuffers& buffers, const cv::Mat& source,
+                        const cv::Mat& alpha, const TileJob* jobs, int count, const TileLayout& layout) {
+    bindBuffers(session, buffers, count, layout.tensorSize, layout.scale);
+    
+    const int tensorH = layout.tensorSize.height;
+    const int tensorW = layout.tensorSize.width;
+    const size_t planeSize = static_cast<size_t>(tensorH) * tensorW;
+    
+    for (int i = 0; i < count; ++i) {
+        // Alpha tiles go through the same network as a grey RGB tile
+        const cv::Mat& plane = jobs[i].alpha ? alpha : source;
+        const int channels = plane.channels();
+        const int last = channels >= 3 ? 2 : 0;
+        
+        // Pad bottom/right up to the tensor shape by reflecting inside the tile
+        cv::Rect region = tileRegion(jobs[i].origin, plane.size(), layout);
+        for (int h = 0; h < tensorH; ++h) {
+            buffers.rowIndex[h] = region.y + cv::borderInterpolate(h, region.height, cv::BORDER_REFLECT_101);
+        }
+        for (int w = 0; w < tensorW; ++w) {
+            buffers.colIndex[w] = region.x + cv::borderInterpolate(w, region.width, cv::BORDER_REFLECT_101);
+        }
+        
+        // u8 BGR(A) HWC -> normalised RGB CHW straight into the bound input tensor
+        float* planeR = buffers.input.data() + i * 3 * planeSize;
+        float* planeG = planeR + planeSize;
+        float* planeB = planeG + planeSize;
+        for (int h = 0; h < tensorH; ++h) {
+            const uchar* srcRow = plane.ptr<uchar>(buffers.rowIndex[h]);
+            size_t rowOffset = static_cast<size_t>(h) * tensorW;
+            
+            // Columns inside the tile are contiguous in the source
+            packBgrToPlanarRgb(srcRow + region.x * channels, channels, region.width,
+                               planeR + rowOffset, planeG + rowOffset, planeB + rowOffset);
+            
+            for (int w = region.width; w < tensorW; ++w) {
+                const uchar* px = srcRow + buffers.colIndex[w] * channels;
+                planeR[rowOffset + w] = px[last] * (1.0f / 255.0f);
+                planeG[rowOffset + w] = px[last / 2] * (1.0f / 255.0f);
+                planeB[rowOffset + w] = px[0] * (1.0f / 255.0f);
+            }
+        }
+    }
+    
+    // Closes the observer's bracket even when a cancelled Run throws
+    struct RunScope {
+        const std::function<void(bool)>& observer;
+        explicit RunScope(const std::function<void(bool)>& o) : observer(o) {
+            if (observer) observer(true);
+        }
+        ~RunScope() {
+            if (observer) observer(false);
+        }
+    } runScope(m_runObserver);
+    session.session->Run(buffers.runOptions, *buffers.current->binding);
+}
+
+void Upscaler::featherWeights(int coreStart, int coreEnd, int extentStart, int extentEnd,
+                              int imageEnd, int overlap, int scale, std::vector<float>& weights) {
+    // Linear ramps across [boundary - overlap, boundary + overlap] on edges shared
+    // with a neighbour. The neighbour's ramp is the mirror image, so weights sum
+    // to one everywhere and the model's unreliable tile edges fade out.
+    weights.resize(static_cast<size_t>(extentEnd - extentStart) * scale);
+    const float ramp = 2.0f * overlap;
+    for (size_t i = 0; i < weights.size(); ++i) {
+        float p = extentStart + (i + 0.5f) / scale;
+        float w = 1.0f;
+        if (overlap > 0 && coreStart > 0) {
+            w = std::min(w, std::clamp((p - (coreStart - overlap)) / ramp, 0.0f, 1.0f));
+        }
+        if (overlap > 0 && coreEnd < imageEnd) {
+            w = std::min(w, std::clamp(((coreEnd + overlap) - p) / ramp, 0.0f, 1.0f));
+        }
+        weights[i] = w;
+    }
+}
+
+cv::Rect Upscaler::featherTile(cv::Point origin, cv::Size inputSize, const TileLayout& layout,
+                              std::vector<float>& rowWeights, std::vector<float>& colWeights) {
+    cv::Rect region = tileRegion(origin, inputSize, layout);
+    int coreEndX = std::min(inputSize.width, origin.x + layout.tileSize);
+    int coreEndY = std::min(inputSize.height, origin.y + layout.tileSize);
+    featherWeights(origin.x, coreEndX, region.x, region.x + region.width,
+                   inputSize.width, layout.overlap, layout.scale, colWeights);
+    featherWeights(origin.y, coreEndY, region.y, region.y + region.height,
+                   inputSize.height, layout.overlap, layout.scale, rowWeights);
+    return region;
+}
+
+void Upscaler::fillTile(const cv::Mat& source, cv::Point origin, const TileLayout& layout,
+                        TileBuffers& scratch, cv::Mat* accumulator, int accumulatorY) {
+    // Invisible under alpha = 0, so bilinear colour is plenty - it only has to
+    // keep the feathered neighbours' weights summing to one
+    cv::Rect region = featherTile(origin, source.size(), layout, scratch.rowWeights, scratch.colWeights);
+    
+    const int scale = layout.scale;
+    const cv::Size outSize(region.width * scale, region.height * scale);
+    if (scratch.fillStorage.rows < outSize.height || scratch.fillStorage.cols < outSize.width ||
+        scratch.fillStorage.type() != source.type()) {
+        // Sized for a whole tile once, edge tiles resize into a corner of it
+        int tileOut = (layout.tileSize + 2 * layout.overlap) * scale;
+        scratch.fillStorage.create(std::max(tileOut, outSize.height), std::max(tileOut, outSize.width), source.type());
+    }
+    cv::Mat resized = scratch.fillStorage(cv::Rect(cv::Point(), outSize));
+    cv::resize(source(region), resized, outSize, 0, 0, cv::INTER_LINEAR);
+    
+    const int dstX = region.x * scale;
+    const int dstY = region.y * scale - accumulatorY;
+    scratch.fillPlanes.resize(std::max<size_t>(scratch.fillPlanes.size(), static_cast<size_t>(3) * resized.cols));
+    float* r = scratch.fillPlanes.data();
+    float* g = r + resized.cols;
+    float* b = g + resized.cols;
+    for (int y = 0; y < resized.rows; ++y) {
+        packBgrToPlanarRgb(resized.ptr<uchar>(y), resized.channels(), resized.cols, r, g, b);
+        const float* planes[3] = {r, g, b};
+        for (int c = 0; c < 3; ++c) {
+            accumulateWeighted(planes[c], scratch.colWeights.data(), scratch.rowWeights[y], resized.cols,
+                               accumulator[c].ptr<float>(dstY + y) + dstX);
+        }
+    }
+}
+
+void Upscaler::scheduleTile(const cv::Mat& alpha, cv::Point origin, const TileLayout& layout,
+                            const TileLayout* halfLayout, bool alphaTiles,
+                            std::vector<TileJob>& jobs, std::vector<TileJob>& fills) {
+    auto addJob = [&](cv::Point at, bool half) {
+        jobs.push_back({at, false, half});
+        if (alphaTiles) jobs.push_back({at, true, half});
+    };
+    if (alpha.empty()) {
+        addJob(origin, false);
+        return;
+    }
+    
+    // The padded region decides - a visible pixel in the overlap still needs real colour
+    auto transparent = [&](cv::Point at, const TileLayout& tileLayout) {
+        return cv::countNonZero(alpha(tileRegion(at, alpha.size(), tileLayout))) == 0;
+    };
+    if (transparent(origin, layout)) {
+        fills.push_back({origin, false, false});
+        return;
+    }
+    
+    // Mostly transparent tiles: run only the quadrants with visible pixels,
+    // when they add up to a smaller tensor area than the whole tile
+    if (halfLayout) {
+        const int half = halfLayout->tileSize;
+        std::vector<cv::Point> needed;
+        std::vector<cv::Point> empty;
+        for (int dy = 0; dy < layout.tileSize; dy += half) {
+            for (int dx = 0; dx < layout.tileSize; dx += half) {
+                cv::Point quadrant(origin.x + dx, origin.y + dy);
+                if (quadrant.x >= alpha.cols || quadrant.y >= alpha.rows) continue;
+                (transparent(quadrant, *halfLayout) ? empty : needed).push_back(quadrant);
+            }
+        }
+        if (static_cast<int>(needed.size()) * halfLayout->tensorSize.area() < layout.tensorSize.area()) {
+            for (const cv::Point& quadrant : needed) addJob(quadrant, true);
+            for (const cv::Point& quadrant : empty) fills.push_back({quadrant, false, true});
+            return;
+        }
+    }
+    addJob(origin, false);
+}
+
+void Upscaler::blendBatch(TileBuffers& buffers, const TileJob* jobs, int count,
+                          cv::Size inputSize, const TileLayout& layout, cv::Mat* accumulator,
+                          int accumulatorY, std::mutex& accumulatorMutex) {
+    const int scale = layout.scale;
+    const int outTileW = buffers.tensorSize.width * scale;
+    const size_t planeSize = static_cast<size_t>(buffers.tensorSize.height) * scale * outTileW;
+    const std::vector<float>& rowWeights = buffers.rowWeights;
+    const std::vector<float>& colWeights = buffers.colWeights;
+    
+    for (int i = 0; i < count; ++i) {
+        cv::Rect region = featherTile(jobs[i].origin, inputSize, layout, buffers.rowWeights, buffers.colWeights);
+        
+        // The padded region starts at the tensor origin, so output rows map 1:1
+        const int outW = region.width * scale;
+        const int outH = region.height * scale;
+        const int dstX = region.x * scale;
+        const int dstY = region.y * scale - accumulatorY;
+        const float* planes[3] = {buffers.output.data() + i * 3 * planeSize,
+                                  buffers.output.data() + i * 3 * planeSize + planeSize,
+                                  buffers.output.data() + i * 3 * planeSize + 2 * planeSize};
+        
+        // Neighbouring tiles add into the same overlap strips. Alpha tiles
+        // average their three output channels into the fourth plane.
+        std::lock_guard<std::mutex> lock(accumulatorMutex);
+        for (int c = 0; c < 3; ++c) {
+            cv::Mat& target = accumulator[jobs[i].alpha ? 3 : c];
+            float channelWeight = jobs[i].alpha ? 1.0f / 3.0f : 1.0f;
+            for (int y = 0; y < outH; ++y) {
+                accumulateWeighted(planes[c] + static_cast<size_t>(y) * outTileW, colWeights.data(),
+                                   rowWeights[y] * channelWeight, outW, target.ptr<float>(dstY + y) + dstX);
+            }
+        }
+    }
+}
+
+bool Upscaler::verifyBatching(OnnxSession& session, const cv::Mat& source, const cv::Mat& alpha,
+                              const TileJob* jobs, int count, const TileLayout& layout) {
+    // Batched results must match the single-tile path for the same padded input
+    TileBuffers batched;
+    TileBuffers single;
+    runBatch(session, batched, source, alpha, jobs, count, layout);
+    
+    const size_t tileValues = static_cast<size_t>(3) * layout.tensorSize.area() * layout.scale * layout.scale;
+    for (int i = 0; i < count; ++i) {
+        runBatch(session, single, source, alpha, jobs + i, 1, layout);
+        
+        double diff = 0.0;
+        const float* fromBatch = batched.output.data() + i * tileValues;
+        for (size_t j = 0; j < tileValues; ++j) {
+            diff = std::max(diff, static_cast<double>(std::abs(fromBatch[j] - single.output[j])));
+        }
+        if (diff > BATCH_TOLERANCE) {
+            qDebug() << "Batched inference differs from single-tile path by" << diff << "- disabling batching";
+            return false;
+        }
+    }
+    qDebug() << "Batched inference verified against single-tile path";
+    return true;
+}
+
+QString Upscaler::getCalibrationPath() const {
+    QString appData = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    return QDir(appData + "/models").filePath("tile_calibration.json");
+}
+
+QString Upscaler::calibrationKey(const QString& modelPath) {
+    // A new model file, CPU or amount of RAM invalidates the measurement
+    QString hash = "missing";
+    QFile file(modelPath);
+    if (file.open(QIODevice::ReadOnly)) {
+        QCryptographicHash sha(QCryptographicHash::Sha1);
+        sha.addData(&file);
+        hash = QString::fromLatin1(sha.result().toHex());
+    }
+    
+    size_t memoryGb = (totalMemoryBytes() + (size_t(1) << 29)) >> 30;
+    return QString("%1/%2-%3cores/%4GB")
+        .arg(hash)
+        .arg(QSysInfo::currentCpuArchitecture())
+        .arg(std::thread::hardware_concurrency())
+        .arg(memoryGb);
+}
+
+int Upscaler::cachedTileSize(const QString& modelPath) {
+    if (m_tileSizeOverride > 0) return m_tileSizeOverride;
+    
+    std::lock_guard<std::mutex> lock(m_calibrationMutex);
+    auto it = m_calibratedTileSizes.constFind(modelPath);
+    if (it != m_calibratedTileSizes.constEnd()) return it.value();
+    
+    QFile file(getCalibrationPath());
+    if (file.open(QIODevice::ReadOnly)) {
+        QJsonObject cache = QJsonDocument::fromJson(file.readAll()).object();
+        int tileSize = cache.value(calibrationKey(modelPath)).toInt(0);
+        if (tileSize > 0) {
+            m_calibratedTileSizes.insert(modelPath, tileSize);
+            return tileSize;
+        }
+    }
+    return 0;
+}
+
+int Upscaler::calibrateTileSize(const QString& modelPath, OnnxSession& session, int scale, int overlap, int workers) {
+    qDebug() << "Calibrating tile size for" << modelPath;
+    
+    // Noise keeps the model from taking any data-dependent shortcuts
+    int largest = TILE_SIZE_CANDIDATES[std::size(TILE_SIZE_CANDIDATES) - 1] + 2 * overlap;
+    cv::Mat source(largest, largest, CV_8UC3);
+    cv::randu(source, cv::Scalar::all(0), cv::Scalar::all(255));
+    const TileJob job{};
+    
+    // Every worker holds one tile, so all of them must fit in half of free memory
+    size_t budget = availableMemoryBytes() / 2 / std::max(1, workers);
+    
+    int best = DEFAULT_TILE_SIZE;
+    double bestRate = 0.0;
+    for (int candidate : TILE_SIZE_CANDIDATES) {
+        TileLayout layout = makeLayout(source.size(), candidate, overlap, scale);
+        if (tileWorkingSetBytes(layout.tensorSize, scale) > budget) {
+            qDebug() << "  " << candidate << "px: exceeds memory budget";
+            break;
+        }
+        
+        // One warm-up run, then time the second - first runs pay for allocation
+        TileBuffers buffers;
+        ActiveRun activeRun(this, &buffers);
+        runBatch(session, buffers, source, cv::Mat(), &job, 1, layout);
+        auto start = std::chrono::steady_clock::now();
+        runBatch(session, buffers, source, cv::Mat(), &job, 1, layout);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        
+        // Only the tile core is useful output - the overlap is recomputed by neighbours
+        double rate = static_cast<double>(candidate) * candidate / std::max(seconds, 1e-6);
+        qDebug() << "  " << candidate << "px:" << rate / 1e6 << "MP/s";
+        
+        if (rate > bestRate) {
+            best = candidate;
+            bestRate = rate;
+        } else if (rate < bestRate * CALIBRATION_FALLOFF) {
+            break;  // Past the sweet spot - larger tiles only get slower
+        }
+    }
+    
+    std::lock_guard<std::mutex> lock(m_calibrationMutex);
+    m_calibratedTileSizes.insert(modelPath, best);
+    
+    // Persist next to the models so calibration runs once per machine
+    QFile file(getCalibrationPath());
+    QJsonObject cache;
+    if (file.open(QIODevice::ReadOnly)) {
+        cache = QJsonDocument::fromJson(file.readAll()).object();
+        file.close();
+    }
+    cache.insert(calibrationKey(modelPath), best);
+    if (file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        file.write(QJsonDocument(cache).toJson());
+    } else {
+        qDebug() << "Cannot save tile calibration:" << file.errorString();
+    }
+    
+    qDebug() << "Calibrated tile size:" << best << "px";
+    return best;
+}
+
+void Upscaler::emitTilePreviews(const TileBuffers& buffers, const TileJob* jobs, int count,
+                                const cv::Mat& source, const TileLayout& layout, double previewScale) {
+    const int scale = layout.scale;
+    const int outTileW = buffers.tensorSize.width * scale;
+    const size_t planeSize = static_cast<size_t>(buffers.tensorSize.height) * scale * outTileW;
+    
+    for (int i = 0; i < count; ++i) {
+        if (jobs[i].alpha) continue;
+        
+        // Raw model output of the tile core - unfeathered, but that's fine for judging quality
+        cv::Point origin = jobs[i].origin;
+        cv::Rect region = tileRegion(origin, source.size(), layout);
+        cv::Rect core(origin.x, origin.y,
+                      std::min(layout.tileSize, source.cols - origin.x),
+                      std::min(layout.tileSize, source.rows - origin.y));
+        int srcX = (core.x - region.x) * scale;
+        int srcY = (core.y - region.y) * scale;
+        
+        cv::Mat alphaCore;
+        if (source.channels() == 4) {
+            cv::extractChannel(source(core), alphaCore, 3);
+            cv::resize(alphaCore, alphaCore, cv::Size(core.width * scale, core.height * scale), 0, 0, cv::INTER_CUBIC);
+        }
+        
+        cv::Mat tile(core.height * scale, core.width * scale, alphaCore.empty() ? CV_8UC3 : CV_8UC4);
+        const float* planeR = buffers.output.data() + i * 3 * planeSize;
+        for (int y = 0; y < tile.rows; ++y) {
+            size_t rowOffset = static_cast<size_t>(srcY + y) * outTileW + srcX;
+            unpackPlanarRgbToBgr(planeR + rowOffset, planeR + planeSize + rowOffset,
+                                 planeR + 2 * planeSize + rowOffset,
+                                 alphaCore.empty() ? nullptr : alphaCore.ptr<uchar>(y),
+                                 tile.cols, tile.ptr<uchar>(y));
+        }
+        
+        if (previewScale < scale) {
+            cv::Size previewSize(std::max(1, cvRound(core.width * previewScale)),
+                                 std::max(1, cvRound(core.height * previewScale)));
+            cv::resize(tile, tile, previewSize, 0, 0, cv::INTER_AREA);
+        }
+        
+        // BGRA bytes are ARGB32 on little-endian
+        QImage image(tile.data, tile.cols, tile.rows, static_cast<int>(tile.step),
+                     tile.channels() == 4 ? QImage::Format_ARGB32 : QImage::Format_BGR888);
+        emit tilePreviewReady(QRect(core.x, core.y, core.width, core.height), image.copy());
+    }
+}
+
+QVector<Upscaler::PrecisionReport> Upscaler::benchmarkPrecisions(Model model, const cv::Mat& sample) {
+    const Precision savedPrecision = m_precision;
+    const int scale = getModelScale(model);
+    QVector<PrecisionReport> reports;
+    cv::Mat reference;
+    double referenceSeconds = 0.0;
+    QJsonObject json;
+    
+    for (Precision precision : {PrecisionFP32, PrecisionFP16, PrecisionINT8}) {
+        if (!isVariantAvailable(model, precision)) continue;
+        m_precision = precision;
+        
+        // The first run loads sessions and calibrates tiles - only time the second
+        MatUpscaleSink warmup;
+        MatUpscaleSink sink;
+        if (!upscaleToSink(sample, model, scale, warmup)) continue;
+        auto start = std::chrono::steady_clock::now();
+        if (!upscaleToSink(sample, model, scale, sink)) continue;
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        
+        if (precision == PrecisionFP32) {
+            reference = sink.result();
+            referenceSeconds = seconds;
+        }
+        if (reference.empty()) break;  // Nothing to compare against
+        
+        PrecisionReport report;
+        report.precision = precision;
+        report.seconds = seconds;
+        report.speedup = referenceSeconds / std::max(seconds, 1e-9);
+        report.psnr = cv::PSNR(reference, sink.result());
+        reports.append(report);
+        
+        qDebug() << getPrecisionName(precision) << ":" << seconds << "s," << report.speedup << "x,"
+                 << report.psnr << "dB PSNR vs FP32";
+        
+        QJsonObject entry;
+        entry.insert("seconds", report.seconds);
+        entry.insert("speedup", report.speedup);
+        entry.insert("psnr", report.psnr);
+        json.insert(getPrecisionName(precision), entry);
+    }
+    m_precision = savedPrecision;
+    
+    // Automatic precision selection consults this report
+    if (!json.isEmpty()) {
+        json.insert("cpu", QSysInfo::currentCpuArchitecture());
+        json.insert("sample", QString("%1x%2").arg(sample.cols).arg(sample.rows));
+        QFile file(getPrecisionReportPath(model));
+        if (file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            file.write(QJsonDocument(json).toJson());
+        } else {
+            qDebug() << "Cannot save precision report:" << file.errorString();
+        }
+    }
+    return reports;
 }
 
 cv::Mat Upscaler::upscale(const cv::Mat& input, Model model, int scale) {
+    MatUpscaleSink sink;
+    if (upscaleToSink(input, model, scale, sink)) {
+        return sink.result();
+    }
+    if (m_cancelRequested.load()) {
+        return cv::Mat();  // Cancelled runs get no fallback result
+    }
+    
+    // Fallback to bicubic resize
+    qDebug() << "Using fallback resize";
+    cv::Mat output;
+    cv::resize(input, output, cv::Size(), scale, scale, cv::INTER_CUBIC);
+    return output;
+}
+
+cv::Mat Upscaler::upscaleAlphaBand(const cv::Mat& alpha, int y, int rows, int scale, cv::Mat& storage) {
+    // Bicubic needs two source rows either side; with an integer scale the
+    // resized ROI matches the full-image resize exactly away from its edges
+    int srcY = std::max(0, y - ALPHA_CONTEXT_ROWS);
+    int srcEnd = std::min(alpha.rows, y + rows + ALPHA_CONTEXT_ROWS);
+    
+    // Resized into the caller's buffer, which fits the largest band
+    cv::Mat resized = storage.rowRange(0, (srcEnd - srcY) * scale);
+    cv::resize(alpha.rowRange(srcY, srcEnd), resized, resized.size(), 0, 0, cv::INTER_CUBIC);
+    return resized.rowRange((y - srcY) * scale, (y - srcY + rows) * scale);
+}
+
+bool Upscaler::upscaleToSink(const cv::Mat& input, Model model, int scale, UpscaleSink& sink) {
     qDebug() << "=== UPSCALE START ===";
     qDebug() << "Model:" << getModelName(model);
     qDebug() << "Scale:" << scale;
@@ -266,241 +1335,448 @@ cv::Mat Upscaler::upscale(const cv::Mat& input, Model model, int scale) {
         QString msg = "Model not downloaded. Please download the model first.";
         qDebug() << msg;
         emit error(msg);
-        // Fallback to bicubic resize
-        cv::Mat output;
-        cv::resize(input, output, cv::Size(), scale, scale, cv::INTER_CUBIC);
-        return output;
+        return false;
     }
     
-    // Load model if not already loaded or different model
-    if (!m_session || m_currentModel != model) {
-        qDebug() << "Loading model...";
-        if (!loadModel(model)) {
-            qDebug() << "Failed to load model, using fallback resize";
-            cv::Mat output;
-            cv::resize(input, output, cv::Size(), scale, scale, cv::INTER_CUBIC);
-            return output;
-        }
+    m_cancelRequested = false;
+    
+    // Balance concurrent tiles against intra-op threads for this machine
+    Precision precision = resolvePrecision(model);
+    QString modelPath = getModelPath(model, precision);
+    qDebug() << "Precision:" << getPrecisionName(precision);
+    
+    int tileSize = cachedTileSize(modelPath);
+    int plannedTile = tileSize > 0 ? tileSize : DEFAULT_TILE_SIZE;
+    int tilesY = (input.rows + plannedTile - 1) / plannedTile;
+    int tilesX = (input.cols + plannedTile - 1) / plannedTile;
+    ThreadPlan plan = planThreads(tilesY * tilesX);
+    
+    // Reuse warm sessions if this model was used recently
+    std::vector<std::shared_ptr<OnnxSession>> sessions = acquireSessions(modelPath, plan);
+    if (sessions.empty()) {
+        qDebug() << "Failed to load model";
+        return false;
+    }
+    if (m_cancelRequested.load()) {
+        qDebug() << "Upscale cancelled";
+        return false;
     }
     
+    // Keep the sessions alive for the next request, then release them when idle
+    m_activeJobs++;
+    struct IdleReleaseGuard {
+        Upscaler* owner;
+        ~IdleReleaseGuard() {
+            owner->m_activeJobs--;
+            owner->scheduleIdleRelease();
+        }
+    } idleGuard{this};
+    
     emit progressChanged(0);
     
     try {
-        // Handle alpha channel separately
-        cv::Mat rgb;
+        // Tiles are packed straight from 8-bit BGR(A) - no float copy of the input
+        cv::Mat source = input;
         cv::Mat alpha;
         bool hasAlpha = (input.channels() == 4);
         
         if (hasAlpha) {
             qDebug() << "Image has alpha channel, extracting...";
-            std::vector<cv::Mat> channels;
-            cv::split(input, channels);
-            cv::merge(std::vector<cv::Mat>{channels[0], channels[1], channels[2]}, rgb);
-            alpha = channels[3].clone();
-        } else if (input.channels() == 3) {
-            rgb = input;
-        } else {
+            cv::extractChannel(input, alpha, 3);
+        } else if (input.channels() == 1) {
             // Convert grayscale to RGB
-            cv::cvtColor(input, rgb, cv::COLOR_GRAY2BGR);
+            cv::cvtColor(input, source, cv::COLOR_GRAY2BGR);
         }
         
-        // Convert to float32 and normalize to [0, 1]
-        cv::Mat inputFloat;
-        rgb.convertTo(inputFloat, CV_32FC3, 1.0 / 255.0);
-        
         // Calculate output size
         int outHeight = input.rows * scale;
         int outWidth = input.cols * scale;
-        cv::Mat output = cv::Mat::zeros(outHeight, outWidth, CV_32FC3);
+        if (!sink.begin(outWidth, outHeight, hasAlpha ? CV_8UC4 : CV_8UC3)) {
+            emit error("Cannot allocate upscale output");
+            return false;
+        }
         
         qDebug() << "Output size will be:" << outWidth << "x" << outHeight;
         
-        // Process in tiles to handle large images
-        // Using 256x256 tiles with 16px overlap for better blending
-        const int tileSize = 256;
-        const int tilePadding = 16;
-        
-        int tilesY = (inputFloat.rows + tileSize - 1) / tileSize;
-        int tilesX = (inputFloat.cols + tileSize - 1) / tileSize;
-        int totalTiles = tilesY * tilesX;
-        int currentTile = 0;
-        
-        qDebug() << "Processing" << totalTiles << "tiles...";
-        
-        for (int ty = 0; ty < inputFloat.rows; ty += tileSize) {
-            for (int tx = 0; tx < inputFloat.cols; tx += tileSize) {
-                currentTile++;
-                int progress = (currentTile * 100) / totalTiles;
-                emit progressChanged(progress);
-                
-                // Calculate tile boundaries with padding
-                int tileY = std::max(0, ty - tilePadding);
-                int tileX = std::max(0, tx - tilePadding);
-                int tileEndY = std::min(inputFloat.rows, ty + tileSize + tilePadding);
-                int tileEndX = std::min(inputFloat.cols, tx + tileSize + tilePadding);
-                int tileH = tileEndY - tileY;
-                int tileW = tileEndX - tileX;
-                
-                // Extract tile
-                cv::Mat tile = inputFloat(cv::Rect(tileX, tileY, tileW, tileH)).clone();
-                
-                // Pad tile to ensure dimensions are even (required by Real-ESRGAN pixel-shuffle)
-                int padH = (tileH % 2 != 0) ? 1 : 0;
-                int padW = (tileW % 2 != 0) ? 1 : 0;
-                if (padH > 0 || padW > 0) {
-                    cv::copyMakeBorder(tile, tile, 0, padH, 0, padW, cv::BORDER_REFLECT_101);
-                    tileH += padH;
-                    tileW += padW;
+        int workers = static_cast<int>(sessions.size());
+        OnnxSession& primary = *sessions[0];
+        if (tileSize <= 0) {
+            tileSize = calibrateTileSize(modelPath, primary, scale, m_tileOverlap, workers);
+        }
+        
+        // Each tile extends `overlap` pixels into its neighbours and is feathered there
+        const TileLayout layout = makeLayout(source.size(), tileSize, m_tileOverlap, scale);
+        const int overlap = layout.overlap;
+        const cv::Size tensorSize = layout.tensorSize;
+        
+        // Alpha through the model adds a tile per colour tile, right behind it so
+        // both usually land in the same batch
+        const AlphaMode alphaMode = hasAlpha ? m_alphaMode : AlphaBicubic;
+        const bool alphaTiles = (alphaMode == AlphaModel);
+        const int planeCount = alphaTiles ? 4 : 3;
+        
+        // Transparent areas skip the network: fully transparent tiles get a cheap
+        // fill, mostly transparent ones may be split into quadrants. Quadrants
+        // need the same overlap as whole tiles for the feathering to line up.
+        const TileLayout halfLayout = makeLayout(source.size(), tileSize / 2, m_tileOverlap, scale);
+        const bool canSplit = hasAlpha && tileSize % 2 == 0 && halfLayout.overlap == overlap &&
+                              tileSize / 2 >= MIN_TILE_SIZE;
+        
+        tilesY = (source.rows + tileSize - 1) / tileSize;
+        tilesX = (source.cols + tileSize - 1) / tileSize;
+        std::vector<std::vector<TileJob>> rowJobs(tilesY);
+        std::vector<std::vector<TileJob>> rowFills(tilesY);
+        for (int ty = 0; ty < tilesY; ++ty) {
+            for (int tx = 0; tx < tilesX; ++tx) {
+                scheduleTile(alpha, cv::Point(tx * tileSize, ty * tileSize), layout,
+                             canSplit ? &halfLayout : nullptr, alphaTiles, rowJobs[ty], rowFills[ty]);
+            }
+        }
+        
+        int totalTiles = 0;
+        int skippedTiles = 0;
+        const TileJob* firstJob = nullptr;
+        for (int ty = 0; ty < tilesY; ++ty) {
+            totalTiles += static_cast<int>(rowJobs[ty].size());
+            skippedTiles += static_cast<int>(rowFills[ty].size());
+            if (!firstJob && !rowJobs[ty].empty()) firstJob = &rowJobs[ty][0];
+        }
+        const int totalWork = std::max(1, totalTiles + skippedTiles);
+        const int jobsPerRow = std::max(1, (totalTiles + tilesY - 1) / tilesY);
+        
+        // Group tiles into [N,3,H,W] batches when the model has a dynamic batch dim
+        int batchSize = 1;
+        if (primary.dynamicBatch && totalTiles > 1 && primary.batchCheck.load() != BatchUnsupported) {
+            batchSize = chooseBatchSize(tensorSize, scale, workers);
+            // Don't let large batches starve workers of tiles
+            batchSize = std::min(batchSize, (totalTiles + workers - 1) / workers);
+            
+            if (batchSize > 1 && primary.batchCheck.load() == BatchUnchecked) {
+                // Two copies of one tile - the batched results must still match
+                const TileJob twins[2] = {*firstJob, *firstJob};
+                bool ok = verifyBatching(primary, source, alpha, twins, 2, firstJob->half ? halfLayout : layout);
+                for (auto& session : sessions) {
+                    session->batchCheck = ok ? BatchVerified : BatchUnsupported;
                 }
-                
-                // Convert BGR to RGB
-                cv::Mat tileRGB;
-                cv::cvtColor(tile, tileRGB, cv::COLOR_BGR2RGB);
-                
-                // Create input tensor [1, 3, H, W] - NCHW format
-                std::vector<int64_t> inputShape = {1, 3, tileH, tileW};
-                std::vector<float> inputTensorValues(3 * tileH * tileW);
-                
-                // Convert HWC to CHW
-                for (int c = 0; c < 3; ++c) {
-                    for (int h = 0; h < tileH; ++h) {
-                        for (int w = 0; w < tileW; ++w) {
-                            inputTensorValues[c * tileH * tileW + h * tileW + w] = 
-                                tileRGB.at<cv::Vec3f>(h, w)[c];
-                        }
+                if (!ok) batchSize = 1;
+            }
+        }
+        
+        // Preview tiles at up to the output scale, capped so the preview stays a manageable size
+        double previewScale = std::min<double>(
+            scale, std::sqrt(PREVIEW_MAX_PIXELS / (static_cast<double>(source.rows) * source.cols)));
+        
+        // Output is produced in bands of whole tile rows - just enough rows per
+        // band to keep every worker busy, so peak memory stays a few tile rows
+        int rowsPerBand = std::clamp((workers * batchSize + jobsPerRow - 1) / jobsPerRow, 1, tilesY);
+        
+        qDebug() << "Processing" << totalTiles << "tiles (" << skippedTiles << "transparent skipped) in batches of"
+                 << batchSize << "on" << workers
+                 << "session(s) x" << plan.intraOpThreads << "intra-op threads," << rowsPerBand
+                 << "tile row(s) per band," << tileSize << "px tiles," << overlap << "px overlap";
+        
+        std::atomic<int> completedTiles{0};
+        double alphaSeconds = 0.0;
+        auto startTime = std::chrono::steady_clock::now();
+        
+        // Tiles are blended into planar float accumulators covering the band plus
+        // the overlap either side. The last 2*overlap rows still await the next
+        // band's tiles, so they slide to the top for the next band instead of
+        // being written out. Sized once for the tallest band.
+        //
+        // A guided-filter output row depends on colour up to 2*GUIDED_RADIUS input
+        // rows away, so in that mode the last rows of a band wait for the next
+        // band's colour, and rows already written stay on top as context.
+        const int alphaLag = (alphaMode == AlphaGuided) ? 2 * GUIDED_RADIUS : 0;
+        const int maxAccRows = std::min(source.rows, rowsPerBand * tileSize + 2 * overlap + 2 * alphaLag);
+        cv::Mat accumulatorStorage[4];
+        for (int c = 0; c < planeCount; ++c) {
+            accumulatorStorage[c].create(maxAccRows * scale, outWidth, CV_32F);
+        }
+        cv::Mat accumulator[4];
+        int carryRows = 0;
+        cv::Mat alphaStorage;
+        if (hasAlpha) {
+            alphaStorage.create(std::min(source.rows, maxAccRows + 2 * ALPHA_CONTEXT_ROWS) * scale, outWidth, CV_8U);
+        }
+        
+        // Band state, refilled for every band without reallocating
+        size_t maxBandJobs = 0;
+        for (int firstRow = 0; firstRow < tilesY; firstRow += rowsPerBand) {
+            size_t jobs = 0;
+            for (int row = firstRow; row < std::min(tilesY, firstRow + rowsPerBand); ++row) {
+                jobs += rowJobs[row].size();
+            }
+            maxBandJobs = std::max(maxBandJobs, jobs);
+        }
+        std::vector<TileJob> bandJobs;
+        std::vector<std::pair<int, int>> batches;  // First job, count
+        bandJobs.reserve(maxBandJobs);
+        batches.reserve(maxBandJobs);
+        int accY = 0;                               // First input row in the accumulators
+        int commitY = 0;                            // First input row not yet written out
+        
+        std::atomic<int> nextBatch{0};
+        std::atomic<bool> failed{false};
+        std::exception_ptr firstError;
+        std::mutex errorMutex;
+        std::mutex accumulatorMutex;
+        
+        // Each worker owns one session and pulls the next batch until none are left
+        auto runBandBatches = [&](OnnxSession& session, TileBuffers& buffers) {
+            try {
+                while (!failed.load() && !m_cancelRequested.load()) {
+                    int index = nextBatch++;
+                    if (index >= static_cast<int>(batches.size())) break;
+                    
+                    const TileJob* batch = bandJobs.data() + batches[index].first;
+                    const int count = batches[index].second;
+                    const TileLayout& batchLayout = batch->half ? halfLayout : layout;
+                    runBatch(session, buffers, source, alpha, batch, count, batchLayout);
+                    blendBatch(buffers, batch, count, source.size(), batchLayout,
+                               accumulator, accY * scale, accumulatorMutex);
+                    if (m_previewEnabled) {
+                        emitTilePreviews(buffers, batch, count, source, batchLayout, previewScale);
                     }
+                    
+                    int done = (completedTiles += count);
+                    emit progressChanged((done * 100) / totalWork);
                 }
-                
-                // Create input tensor
-                auto memoryInfo = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
-                Ort::Value inputTensor = Ort::Value::CreateTensor<float>(
-                    memoryInfo,
-                    inputTensorValues.data(),
-                    inputTensorValues.size(),
-                    inputShape.data(),
-                    inputShape.size()
-                );
-                
-                // Run inference
-                qDebug() << "Running ONNX inference for tile" << currentTile << "/" << totalTiles;
-                qDebug() << "  Input shape:" << inputShape[0] << "x" << inputShape[1] << "x" << inputShape[2] << "x" << inputShape[3];
-                qDebug() << "  Input tensor size:" << inputTensorValues.size();
-                
-                auto outputTensors = m_session->session->Run(
-                    Ort::RunOptions{nullptr},
-                    m_session->inputNames.data(),
-                    &inputTensor,
-                    1,
-                    m_session->outputNames.data(),
-                    1
-                );
-                
-                qDebug() << "  Inference completed for tile" << currentTile;
-                
-                // Get output tensor
-                float* outputData = outputTensors[0].GetTensorMutableData<float>();
-                auto outputShape = outputTensors[0].GetTensorTypeAndShapeInfo().GetShape();
-                
-                qDebug() << "  Output shape:" << outputShape[0] << "x" << outputShape[1] << "x" << outputShape[2] << "x" << outputShape[3];
-                
-                int outTileH = static_cast<int>(outputShape[2]);
-                int outTileW = static_cast<int>(outputShape[3]);
-                
-                // Convert CHW to HWC and RGB to BGR
-                cv::Mat outputTile(outTileH, outTileW, CV_32FC3);
-                for (int c = 0; c < 3; ++c) {
-                    for (int h = 0; h < outTileH; ++h) {
-                        for (int w = 0; w < outTileW; ++w) {
-                            // RGB to BGR: swap channel 0 and 2
-                            outputTile.at<cv::Vec3f>(h, w)[2 - c] = 
-                                outputData[c * outTileH * outTileW + h * outTileW + w];
-                        }
-                    }
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if (!firstError) firstError = std::current_exception();
+                failed = true;
+            }
+        };
+        
+        // Workers, their bound buffers and sessions live for the whole run. The
+        // calling thread is worker 0; helpers wait for each band to be published.
+        const int runWorkers = std::clamp((totalTiles + batchSize - 1) / batchSize, 1, workers);
+        std::vector<TileBuffers> workerBuffers(runWorkers);
+        ActiveRun activeRun(this, workerBuffers.data(), runWorkers);
+        
+        // Bind every batch shape a band can hand a worker now, so a helper that
+        // sat out the first bands doesn't bind mid-run. Largest first - growing
+        // the storage would drop the bindings made before it.
+        bool anyHalf = false;
+        for (const auto& jobs : rowJobs) {
+            for (const TileJob& job : jobs) anyHalf = anyHalf || job.half;
+        }
+        for (int i = 0; i < runWorkers; ++i) {
+            for (int count = batchSize; count >= 1; --count) {
+                bindBuffers(*sessions[i], workerBuffers[i], count, tensorSize, scale);
+                if (anyHalf) bindBuffers(*sessions[i], workerBuffers[i], count, halfLayout.tensorSize, scale);
+            }
+        }
+        
+        std::mutex bandMutex;
+        std::condition_variable bandStarted;
+        std::condition_variable bandFinished;
+        int bandGeneration = 0;
+        int busyHelpers = 0;
+        bool stopHelpers = false;
+        
+        auto helper = [&](int index) {
+            int seen = 0;
+            for (;;) {
+                {
+                    std::unique_lock<std::mutex> lock(bandMutex);
+                    bandStarted.wait(lock, [&] { return stopHelpers || bandGeneration != seen; });
+                    if (stopHelpers) return;
+                    seen = bandGeneration;
                 }
-                
-                // Clip values to [0, 1]
-                cv::threshold(outputTile, outputTile, 1.0, 1.0, cv::THRESH_TRUNC);
-                cv::max(outputTile, 0.0, outputTile);
-                
-                // Crop output tile to remove dimension padding (padH/padW) from even-size requirement
-                if (padH > 0 || padW > 0) {
-                    int cropH = outTileH - padH * scale;
-                    int cropW = outTileW - padW * scale;
-                    outputTile = outputTile(cv::Rect(0, 0, cropW, cropH)).clone();
-                    outTileH = cropH;
-                    outTileW = cropW;
+                runBandBatches(*sessions[index], workerBuffers[index]);
+                std::lock_guard<std::mutex> lock(bandMutex);
+                if (--busyHelpers == 0) bandFinished.notify_one();
+            }
+        };
+        
+        // Joins the helpers on every exit path, cancel and errors included
+        std::vector<std::thread> helpers;
+        struct HelperGuard {
+            std::mutex& mutex;
+            std::condition_variable& started;
+            bool& stop;
+            std::vector<std::thread>& threads;
+            ~HelperGuard() {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    stop = true;
                 }
-                
-                // Calculate where to place this tile in the output
-                // Remove the padding from the processed tile
-                int padTop = (ty > 0) ? tilePadding * scale : 0;
-                int padLeft = (tx > 0) ? tilePadding * scale : 0;
-                int padBottom = (ty + tileSize < inputFloat.rows) ? tilePadding * scale : 0;
-                int padRight = (tx + tileSize < inputFloat.cols) ? tilePadding * scale : 0;
-                
-                int srcX = padLeft;
-                int srcY = padTop;
-                int srcW = outTileW - padLeft - padRight;
-                int srcH = outTileH - padTop - padBottom;
-                
-                int dstX = tx * scale;
-                int dstY = ty * scale;
-                
-                // Ensure we don't exceed output bounds
-                srcW = std::min(srcW, outWidth - dstX);
-                srcH = std::min(srcH, outHeight - dstY);
-                
-                if (srcW > 0 && srcH > 0 && 
-                    srcX + srcW <= outTileW && srcY + srcH <= outTileH &&
-                    dstX + srcW <= outWidth && dstY + srcH <= outHeight) {
-                    
-                    cv::Rect srcRect(srcX, srcY, srcW, srcH);
-                    cv::Rect dstRect(dstX, dstY, srcW, srcH);
-                    outputTile(srcRect).copyTo(output(dstRect));
+                started.notify_all();
+                for (auto& thread : threads) {
+                    thread.join();
                 }
             }
+        } helperGuard{bandMutex, bandStarted, stopHelpers, helpers};
+        helpers.reserve(runWorkers - 1);
+        for (int i = 1; i < runWorkers; ++i) {
+            helpers.emplace_back(helper, i);
         }
         
-        emit progressChanged(100);
-        qDebug() << "=== ONNX INFERENCE COMPLETE ===";
+        for (int firstRow = 0; firstRow < tilesY; firstRow += rowsPerBand) {
+            int bandRows = std::min(rowsPerBand, tilesY - firstRow);
+            int bandY = firstRow * tileSize;
+            int bandEnd = std::min(bandY + bandRows * tileSize, source.rows);
+            bool lastBand = (firstRow + bandRows >= tilesY);
+            
+            accY = std::max(0, commitY - alphaLag);
+            int accEnd = std::min(source.rows, bandEnd + overlap);
+            int accRows = (accEnd - accY) * scale;
+            for (int c = 0; c < planeCount; ++c) {
+                accumulator[c] = accumulatorStorage[c].rowRange(0, accRows);
+                // memset rather than setTo, which takes a scratch buffer per call
+                std::memset(accumulatorStorage[c].ptr(carryRows), 0,
+                            static_cast<size_t>(accRows - carryRows) * accumulatorStorage[c].step[0]);
+            }
+            
+            // Whole tiles first, then quadrants - a batch never mixes tensor shapes
+            bandJobs.clear();
+            for (bool half : {false, true}) {
+                for (int row = firstRow; row < firstRow + bandRows; ++row) {
+                    for (const TileJob& job : rowJobs[row]) {
+                        if (job.half == half) bandJobs.push_back(job);
+                    }
+                }
+            }
+            
+            batches.clear();
+            for (int first = 0; first < static_cast<int>(bandJobs.size());) {
+                int count = 1;
+                while (count < batchSize && first + count < static_cast<int>(bandJobs.size()) &&
+                       bandJobs[first + count].half == bandJobs[first].half) {
+                    ++count;
+                }
+                batches.emplace_back(first, count);
+                first += count;
+            }
+            
+            // Publish the band to the helpers, work on it here too, then wait for them
+            nextBatch = 0;
+            {
+                std::lock_guard<std::mutex> lock(bandMutex);
+                busyHelpers = runWorkers - 1;
+                ++bandGeneration;
+            }
+            bandStarted.notify_all();
+            runBandBatches(*sessions[0], workerBuffers[0]);
+            {
+                std::unique_lock<std::mutex> lock(bandMutex);
+                bandFinished.wait(lock, [&] { return busyHelpers == 0; });
+            }
+            
+            if (firstError) {
+                std::rethrow_exception(firstError);
+            }
+            if (m_cancelRequested.load()) {
+                qDebug() << "Upscale cancelled after" << completedTiles.load() << "of" << totalTiles << "tiles";
+                return false;
+            }
+            
+            for (int row = firstRow; row < firstRow + bandRows; ++row) {
+                for (const TileJob& fill : rowFills[row]) {
+                    fillTile(source, fill.origin, fill.half ? halfLayout : layout, workerBuffers[0],
+                             accumulator, accY * scale);
+                }
+                completedTiles += static_cast<int>(rowFills[row].size());
+            }
+            emit progressChanged((completedTiles.load() * 100) / totalWork);
+            
+            // Rows up to the next band's overlap are final; all but the lag are written
+            int finalEnd = lastBand ? source.rows : bandEnd - overlap;
+            int commitEnd = lastBand ? source.rows : std::max(commitY, finalEnd - alphaLag);
+            int skipRows = (commitY - accY) * scale;    // Context on top, written by the last band
+            int outY = commitY * scale;
+            int outRows = (commitEnd - commitY) * scale;
+            
+            cv::Mat band = sink.bandBuffer(outY, outRows);
+            cv::Mat alphaBand;
+            auto alphaStart = std::chrono::steady_clock::now();
+            if (alphaMode == AlphaModel) {
+                alphaBand = alphaStorage.rowRange(0, outRows);
+                accumulator[3].rowRange(skipRows, skipRows + outRows).convertTo(alphaBand, CV_8U, 255.0);
+            } else if (alphaMode == AlphaGuided) {
+                // Snap the soft bicubic edge to edges in the upscaled colour. Filtered
+                // over every final row, context included, then cropped to the output
+                // rows - band edges come out as a whole-image filter would.
+                int windowRows = (finalEnd - accY) * scale;
+                cv::Mat window = upscaleAlphaBand(alpha, accY, finalEnd - accY, scale, alphaStorage);
+                cv::Mat guide = accumulator[0].rowRange(0, windowRows) * 0.299f +
+                                accumulator[1].rowRange(0, windowRows) * 0.587f +
+                                accumulator[2].rowRange(0, windowRows) * 0.114f;
+                alphaBand = guidedFilter(guide, window, GUIDED_RADIUS * scale, GUIDED_EPS)
+                                .rowRange(skipRows, skipRows + outRows);
+            } else if (hasAlpha) {
+                alphaBand = upscaleAlphaBand(alpha, commitY, commitEnd - commitY, scale, alphaStorage);
+            }
+            alphaSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - alphaStart).count();
+            for (int y = 0; y < outRows; ++y) {
+                unpackPlanarRgbToBgr(accumulator[0].ptr<float>(skipRows + y), accumulator[1].ptr<float>(skipRows + y),
+                                     accumulator[2].ptr<float>(skipRows + y),
+                                     hasAlpha ? alphaBand.ptr<uchar>(y) : nullptr,
+                                     outWidth, band.ptr<uchar>(y));
+            }
+            if (!sink.commitBand(outY, outRows)) {
+                emit error("Failed to write upscaled output");
+                return false;
+            }
+            
+            if (!lastBand) {
+                // Slide the rows still needed - awaiting the next band's tiles, or
+                // guided-filter context - to the top. Source and target may overlap.
+                commitY = commitEnd;
+                int dropRows = (std::max(0, commitY - alphaLag) - accY) * scale;
+                carryRows = accRows - dropRows;
+                for (int c = 0; c < planeCount; ++c) {
+                    std::memmove(accumulatorStorage[c].ptr(0), accumulatorStorage[c].ptr(dropRows),
+                                 static_cast<size_t>(carryRows) * accumulatorStorage[c].step[0]);
+                }
+            }
+        }
         
-        // Convert back to 8-bit
-        cv::Mat result8bit;
-        output.convertTo(result8bit, CV_8UC3, 255.0);
+        if (!sink.finish()) {
+            emit error("Failed to finish upscaled output");
+            return false;
+        }
         
-        // Handle alpha channel
-        if (hasAlpha) {
-            qDebug() << "Merging alpha channel...";
-            // Upscale alpha with bicubic (AI upscaling not needed for alpha)
-            cv::Mat alphaUpscaled;
-            cv::resize(alpha, alphaUpscaled, cv::Size(outWidth, outHeight), 0, 0, cv::INTER_CUBIC);
-            
-            // Merge RGB with alpha
-            std::vector<cv::Mat> channels;
-            cv::split(result8bit, channels);
-            channels.push_back(alphaUpscaled);
-            cv::merge(channels, result8bit);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        UpscaleStats stats;
+        stats.tiles = totalTiles;
+        stats.concurrency = workers;
+        stats.batchSize = batchSize;
+        stats.tileSize = tileSize;
+        stats.precision = precision;
+        stats.alphaMode = alphaMode;
+        stats.skippedTiles = skippedTiles;
+        stats.alphaSeconds = alphaSeconds;
+        stats.intraOpThreads = plan.intraOpThreads;
+        stats.seconds = seconds;
+        stats.tilesPerSecond = seconds > 0.0 ? totalTiles / seconds : 0.0;
+        {
+            std::lock_guard<std::mutex> lock(m_statsMutex);
+            m_lastStats = stats;
         }
         
+        emit progressChanged(100);
         qDebug() << "=== UPSCALE SUCCESS ===";
-        qDebug() << "Result size:" << result8bit.cols << "x" << result8bit.rows;
-        return result8bit;
+        qDebug() << "Throughput:" << stats.tilesPerSecond << "tiles/s (" << totalTiles << "tiles in" << seconds << "s)";
+        qDebug() << "Result size:" << outWidth << "x" << outHeight;
+        return true;
         
     } catch (const Ort::Exception& e) {
+        if (m_cancelRequested.load()) {
+            // Terminated run - not an error
+            qDebug() << "Upscale cancelled:" << e.what();
+            return false;
+        }
         QString msg = QString("ONNX Runtime error: %1").arg(e.what());
         qDebug() << msg;
         emit error(msg);
-        cv::Mat output;
-        cv::resize(input, output, cv::Size(), scale, scale, cv::INTER_CUBIC);
-        qDebug() << "Using fallback resize after ONNX error";
-        return output;
+        return false;
     } catch (const std::exception& e) {
         QString msg = QString("Upscaling error: %1").arg(e.what());
         qDebug() << msg;
         emit error(msg);
-        cv::Mat output;
-        cv::resize(input, output, cv::Size(), scale, scale, cv::INTER_CUBIC);
-        qDebug() << "Using fallback resize after error";
-        return output;
+        return false;
     }
 }
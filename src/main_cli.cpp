@@ -0,0 +1,194 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTextStream>
+#include <algorithm>
+#include "BatchProcessor.h"
+#include "ImageProcessor.h"
+#include "Upscaler.h"
+
+namespace {
+
+constexpr int PRECISION_SAMPLE_SIZE = 512;          // Centre crop - each variant upscales it twice
+
+void printReport(const BatchProcessor& batch, QTextStream& out) {
+    out << QString("%1  %2  %3  %4  %5\n")
+               .arg("stage", -14).arg("images", 8).arg("busy s", 10)
+               .arg("img/s", 8).arg("MP/s", 8);
+
+    for (const auto& stage : batch.stageStats()) {
+        // Per-worker rate - busy time is summed over all workers
+        double imagesPerSecond = stage.seconds > 0.0 ? stage.images / stage.seconds : 0.0;
+        double megapixelsPerSecond = stage.seconds > 0.0 ? stage.megapixels / stage.seconds : 0.0;
+        out << QString("%1  %2  %3  %4  %5\n")
+                   .arg(stage.name, -14)
+                   .arg(stage.images, 8)
+                   .arg(stage.seconds, 10, 'f', 2)
+                   .arg(imagesPerSecond, 8, 'f', 2)
+                   .arg(megapixelsPerSecond, 8, 'f', 1);
+    }
+
+    double wall = batch.wallSeconds();
+    out << QString("\n%1 files in %2 s with %3 workers (%4 files/s)\n")
+               .arg(batch.processedFiles())
+               .arg(wall, 0, 'f', 2)
+               .arg(batch.workerCount())
+               .arg(wall > 0.0 ? batch.processedFiles() / wall : 0.0, 0, 'f', 2);
+}
+
+bool parseModel(const QString& name, Upscaler::Model& model) {
+    if (name == "x2") {
+        model = Upscaler::RealESRGAN_x2;
+    } else if (name == "x4") {
+        model = Upscaler::RealESRGAN_x4;
+    } else if (name == "x4-anime") {
+        model = Upscaler::RealESRGAN_x4_anime;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Times the model's installed INT8/FP16 variants against FP32 on the sample and saves
+// the report next to the model. Automatic precision only picks variants that pass it.
+int runPrecisionReport(Upscaler& upscaler, const QString& modelName, const QStringList& inputs,
+                       QTextStream& out, QTextStream& err) {
+    Upscaler::Model model;
+    if (!parseModel(modelName, model) || inputs.size() != 1) {
+        err << "Usage: pixeleraser-cli --precision-report x2|x4|x4-anime sample.png\n";
+        return 2;
+    }
+    if (!upscaler.isModelAvailable(model)) {
+        err << Upscaler::getModelName(model) << " is not downloaded\n";
+        return 2;
+    }
+
+    ImageProcessor processor;
+    if (!processor.loadImage(inputs[0])) {
+        err << "Cannot load " << inputs[0] << "\n";
+        return 1;
+    }
+    const cv::Mat& image = processor.getCurrentImage();
+    int width = std::min(image.cols, PRECISION_SAMPLE_SIZE);
+    int height = std::min(image.rows, PRECISION_SAMPLE_SIZE);
+    cv::Mat sample = image(cv::Rect((image.cols - width) / 2, (image.rows - height) / 2, width, height)).clone();
+
+    QVector<Upscaler::PrecisionReport> reports = upscaler.benchmarkPrecisions(model, sample);
+    if (reports.isEmpty()) {
+        err << "Precision benchmark failed\n";
+        return 1;
+    }
+
+    out << QString("%1  %2  %3  %4  %5\n")
+               .arg("precision", -10).arg("seconds", 8).arg("speedup", 8).arg("PSNR dB", 8).arg("auto");
+    for (const Upscaler::PrecisionReport& report : reports) {
+        bool fp32 = report.precision == Upscaler::PrecisionFP32;
+        out << QString("%1  %2  %3  %4  %5\n")
+                   .arg(Upscaler::getPrecisionName(report.precision), -10)
+                   .arg(report.seconds, 8, 'f', 2)
+                   .arg(report.speedup, 8, 'f', 2)
+                   .arg(fp32 ? QString("-") : QString::number(report.psnr, 'f', 1), 8)
+                   .arg(fp32 ? "baseline" : Upscaler::passesPrecisionReport(report) ? "allowed" : "vetoed");
+    }
+    if (reports.size() == 1) {
+        out << "No INT8 or FP16 variant next to the model - automatic precision stays on FP32\n";
+    }
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    QCoreApplication app(argc, argv);
+
+    // Same names as the GUI so both share downloaded models and calibration
+    app.setApplicationName("PixelEraser Pro");
+    app.setApplicationVersion("1.0.0");
+    app.setOrganizationName("PixelEraser");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Batch background removal and export");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    QCommandLineOption scriptOption({"s", "script"}, "JSON operation script.", "file");
+    QCommandLineOption outputOption({"o", "output"}, "Output directory.", "dir");
+    QCommandLineOption jobsOption({"j", "jobs"}, "Files processed in parallel (0 = auto).", "count", "0");
+    QCommandLineOption recursiveOption({"r", "recursive"}, "Descend into subdirectories.");
+    QCommandLineOption downloadOption("download", "Download missing upscale models.");
+    QCommandLineOption precisionOption("precision-report",
+                                       "Benchmark the model's INT8/FP16 variants on a sample image "
+                                       "and save the report automatic precision requires.",
+                                       "x2|x4|x4-anime");
+    parser.addOption(scriptOption);
+    parser.addOption(outputOption);
+    parser.addOption(jobsOption);
+    parser.addOption(recursiveOption);
+    parser.addOption(downloadOption);
+    QCommandLineOption tileSizeOption("tile-size",
+                                      "Upscale tile size in input pixels (0 = calibrated for this machine).",
+                                      "pixels", "0");
+    QCommandLineOption recalibrateOption("recalibrate",
+                                         "Forget calibrated tile sizes and benchmark them again on the next upscale.");
+    parser.addOption(precisionOption);
+    parser.addOption(tileSizeOption);
+    parser.addOption(recalibrateOption);
+    parser.addPositionalArgument("inputs", "Image files or directories.", "<inputs...>");
+    parser.process(app);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    Upscaler upscaler;
+    bool tileSizeOk = false;
+    int tileSize = parser.value(tileSizeOption).toInt(&tileSizeOk);
+    if (!tileSizeOk || tileSize < 0) {
+        err << "--tile-size must be a pixel count, or 0 for the calibrated size\n";
+        return 2;
+    }
+    upscaler.setTileSize(tileSize);
+    if (parser.isSet(recalibrateOption)) {
+        upscaler.clearTileCalibration();
+        if (!parser.isSet(scriptOption) && !parser.isSet(precisionOption)) {
+            out << "Tile calibration cleared\n";
+            return 0;
+        }
+    }
+
+    if (parser.isSet(precisionOption)) {
+        return runPrecisionReport(upscaler, parser.value(precisionOption), parser.positionalArguments(),
+                                  out, err);
+    }
+
+    if (!parser.isSet(scriptOption) || !parser.isSet(outputOption) || parser.positionalArguments().isEmpty()) {
+        err << "Usage: pixeleraser-cli --script ops.json --output dir <inputs...>\n";
+        return 2;
+    }
+
+    BatchProcessor batch(&upscaler);
+    if (!batch.loadScript(parser.value(scriptOption))) {
+        err << batch.errorString() << "\n";
+        return 2;
+    }
+    batch.setWorkerCount(parser.value(jobsOption).toInt());
+
+    for (auto model : {Upscaler::RealESRGAN_x2, Upscaler::RealESRGAN_x4, Upscaler::RealESRGAN_x4_anime}) {
+        if (!batch.needsModel(model) || upscaler.isModelAvailable(model)) continue;
+        if (!parser.isSet(downloadOption)) {
+            err << Upscaler::getModelName(model) << " is not downloaded - rerun with --download\n";
+            return 2;
+        }
+        err << "Downloading " << Upscaler::getModelName(model) << "...\n";
+        if (!upscaler.downloadModel(model)) {
+            err << "Download failed\n";
+            return 1;
+        }
+    }
+
+    int failures = batch.run(parser.positionalArguments(), parser.value(outputOption),
+                             parser.isSet(recursiveOption));
+    printReport(batch, out);
+    if (failures > 0) {
+        err << failures << " files failed\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,117 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+#include "HistoryManager.h"
+#include "ImageProcessor.h"
+#include "InteractionLog.h"
+#include "InteractionReplayer.h"
+
+namespace {
+
+QJsonObject toJson(const InteractionReplayer::Report& report, const QString& logPath) {
+    QJsonArray events;
+    for (const auto& stats : report.events) {
+        QJsonObject entry;
+        entry["name"] = stats.name;
+        entry["count"] = stats.count;
+        entry["p50_ms"] = stats.p50Ms;
+        entry["p90_ms"] = stats.p90Ms;
+        entry["p99_ms"] = stats.p99Ms;
+        entry["max_ms"] = stats.maxMs;
+        entry["total_ms"] = stats.totalMs;
+        events.append(entry);
+    }
+
+    QJsonObject root;
+    root["session"] = QFileInfo(logPath).fileName();
+    root["events"] = events;
+    root["total_ms"] = report.totalMs;
+    root["peak_rss_bytes"] = static_cast<qint64>(report.peakRssBytes);
+    return root;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("pixeleraser-replay");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Replay a recorded editing session and report per-event latency");
+    parser.addHelpOption();
+    QCommandLineOption imageOption("image", "Image to replay on instead of the recorded path.", "file");
+    QCommandLineOption jsonOption("json", "Write the report as JSON.", "file");
+    QCommandLineOption pacedOption("paced", "Keep the recorded gaps between events.");
+    parser.addOption(imageOption);
+    parser.addOption(jsonOption);
+    parser.addOption(pacedOption);
+    parser.addPositionalArgument("session", "Interaction log recorded from the canvas.");
+    parser.process(app);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    if (parser.positionalArguments().size() != 1) {
+        parser.showHelp(2);
+    }
+    QString logPath = parser.positionalArguments().first();
+
+    InteractionLog log;
+    QString error;
+    if (!log.load(logPath, &error)) {
+        err << error << "\n";
+        return 2;
+    }
+
+    ImageProcessor processor;
+    QString imagePath = parser.isSet(imageOption) ? parser.value(imageOption) : log.imagePath;
+    if (!processor.loadImage(imagePath)) {
+        err << "Cannot load image " << imagePath << "\n";
+        return 2;
+    }
+    if (processor.getWidth() != log.width || processor.getHeight() != log.height) {
+        err << QString("Image is %1 x %2 but the session was recorded on %3 x %4\n")
+                   .arg(processor.getWidth()).arg(processor.getHeight())
+                   .arg(log.width).arg(log.height);
+        return 2;
+    }
+
+    HistoryManager history;
+    history.setImageProcessor(&processor);
+
+    InteractionReplayer replayer(&processor, &history);
+    replayer.setPaced(parser.isSet(pacedOption));
+    InteractionReplayer::Report report = replayer.replay(log);
+
+    out << QString("%1 %2 %3 %4 %5 %6\n")
+               .arg("event", -12).arg("count", 7).arg("p50 ms", 10)
+               .arg("p90 ms", 10).arg("p99 ms", 10).arg("max ms", 10);
+    for (const auto& stats : report.events) {
+        out << QString("%1 %2 %3 %4 %5 %6\n")
+                   .arg(stats.name, -12)
+                   .arg(stats.count, 7)
+                   .arg(stats.p50Ms, 10, 'f', 3)
+                   .arg(stats.p90Ms, 10, 'f', 3)
+                   .arg(stats.p99Ms, 10, 'f', 3)
+                   .arg(stats.maxMs, 10, 'f', 3);
+    }
+    out << QString("\n%1 events in %2 ms, peak RSS %3 MB\n")
+               .arg(log.events.size())
+               .arg(report.totalMs, 0, 'f', 1)
+               .arg(report.peakRssBytes / (1024.0 * 1024.0), 0, 'f', 1);
+
+    if (parser.isSet(jsonOption)) {
+        QFile file(parser.value(jsonOption));
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            err << "Cannot write " << parser.value(jsonOption) << "\n";
+            return 1;
+        }
+        file.write(QJsonDocument(toJson(report, logPath)).toJson());
+    }
+    return 0;
+}